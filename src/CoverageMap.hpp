@@ -0,0 +1,399 @@
+#pragma once
+#ifndef COVERAGEMAP_HPP
+#define COVERAGEMAP_HPP
+/**
+ * @file CoverageMap.hpp
+ *
+ * @brief persistent set of candidates of recursion search which are
+ * known to be reducible.
+ *
+ * mat of a candidate depends only on id and seq, so a candidate is
+ * identified by (mexp, id, pos, seq), independent of the seed of the
+ * parameter generator. Tested seqs are kept as sets of intervals for
+ * each (mexp, id, pos). This is compact only when pos is fixed. When
+ * pos is random, successive candidates have different pos, and the
+ * intervals of each (mexp, id, pos) become single seqs. Then
+ * candidates are identified by the stream of candidates instead: the
+ * generator of pos, its seed, seq of the first candidate and the
+ * vector width of --simd-pos decide pos of the candidate of each seq,
+ * so tested seqs of a stream are kept as intervals for each (mexp,
+ * id, stream).
+ *
+ * The file is shared by processes. It is read and rewritten while
+ * the lock file, whose name is the file name followed by .lock, is
+ * locked by flock, and new contents are written to a temporary file
+ * and renamed, so readers never see a partial file.
+ *
+ * One map can be shared by threads, for example by ids of id-range
+ * search, then the file is read once for all of them.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <mutex>
+
+/**
+ * @class CoverageMap
+ * @brief intervals of reducible seqs of each (mexp, id, pos) or
+ * (mexp, id, stream).
+ */
+class CoverageMap {
+public:
+    enum {FIXED_POS, MIXED, SPLIT};
+
+    /**
+     * @class stream
+     * @brief stream of candidates whose pos is random. The default is
+     * FIXED_POS, candidates are identified by pos.
+     */
+    struct stream {
+        int generator;          // FIXED_POS, MIXED or SPLIT
+        uint64_t seed;          // seed of the generator of pos
+        uint32_t start;         // seq of the first candidate
+        int width;              // vector width of --simd-pos, or 0
+        stream() : generator(FIXED_POS), seed(0), start(0), width(0) {
+        }
+        stream(int generator, uint64_t seed, uint32_t start, int width) :
+            generator(generator), seed(seed), start(start), width(width) {
+        }
+    };
+
+    /**
+     * Constructor
+     * @param filename file of the map, it need not exist.
+     */
+    explicit CoverageMap(const std::string& filename) :
+        filename(filename) {
+    }
+
+    /**
+     * read the file.
+     * @return false if the file exists but can't be read
+     */
+    bool load() {
+        std::unique_lock<std::mutex> guard(mtx);
+        file_lock lock(filename, LOCK_SH);
+        if (!lock.ok()) {
+            return false;
+        }
+        return read_file(covered);
+    }
+
+    /**
+     * @return true if the candidate is known to be reducible
+     */
+    bool contains(int mexp, uint32_t id, int pos, uint32_t seq) const {
+        return contains(stream(), mexp, id, pos, seq);
+    }
+
+    /**
+     * @param s stream of the candidate
+     * @return true if the candidate is known to be reducible
+     */
+    bool contains(const stream& s, int mexp, uint32_t id, int pos,
+                  uint32_t seq) const {
+        std::unique_lock<std::mutex> guard(mtx);
+        return contains(covered, key(mexp, id, pos, s), seq);
+    }
+
+    /**
+     * add a candidate which is reducible. It is written to the file
+     * by save().
+     */
+    void add(int mexp, uint32_t id, int pos, uint32_t seq) {
+        add(stream(), mexp, id, pos, seq);
+    }
+
+    /**
+     * add a candidate of the stream s which is reducible.
+     */
+    void add(const stream& s, int mexp, uint32_t id, int pos,
+             uint32_t seq) {
+        std::unique_lock<std::mutex> guard(mtx);
+        insert(covered, key(mexp, id, pos, s), seq, seq);
+        insert(pending, key(mexp, id, pos, s), seq, seq);
+    }
+
+    /**
+     * merge candidates added after the last save() into the file.
+     * Candidates added to the file by other processes are read, too.
+     * @return false if the file can't be read or written
+     */
+    bool save() {
+        std::unique_lock<std::mutex> guard(mtx);
+        if (pending.empty()) {
+            return true;
+        }
+        file_lock lock(filename, LOCK_EX);
+        if (!lock.ok()) {
+            return false;
+        }
+        interval_map merged;
+        if (!read_file(merged)) {
+            return false;
+        }
+        merge(merged, pending);
+        std::ostringstream tmp;
+        tmp << filename << ".tmp." << getpid();
+        {
+            std::ofstream ofs(tmp.str().c_str());
+            if (!ofs) {
+                return false;
+            }
+            write(ofs, merged);
+            ofs.close();
+            if (!ofs) {
+                unlink(tmp.str().c_str());
+                return false;
+            }
+        }
+        if (rename(tmp.str().c_str(), filename.c_str()) != 0) {
+            unlink(tmp.str().c_str());
+            return false;
+        }
+        covered.swap(merged);
+        pending.clear();
+        return true;
+    }
+
+    /**
+     * @return number of intervals
+     */
+    long intervals() const {
+        std::unique_lock<std::mutex> guard(mtx);
+        long n = 0;
+        for (interval_map::const_iterator it = covered.begin();
+             it != covered.end(); ++it) {
+            n += static_cast<long>(it->second.size());
+        }
+        return n;
+    }
+private:
+    typedef std::map<uint32_t, uint32_t> interval_set; // first -> last
+    struct key {
+        int mexp;
+        uint32_t id;
+        int pos;                // 0 if s is not FIXED_POS
+        stream s;
+        key(int m, uint32_t i, int p, const stream& s) :
+            mexp(m), id(i), pos(s.generator == FIXED_POS ? p : 0), s(s) {}
+        bool operator<(const key& that) const {
+            if (mexp != that.mexp) {
+                return mexp < that.mexp;
+            }
+            if (id != that.id) {
+                return id < that.id;
+            }
+            if (s.generator != that.s.generator) {
+                return s.generator < that.s.generator;
+            }
+            if (pos != that.pos) {
+                return pos < that.pos;
+            }
+            if (s.seed != that.s.seed) {
+                return s.seed < that.s.seed;
+            }
+            if (s.start != that.s.start) {
+                return s.start < that.s.start;
+            }
+            return s.width < that.s.width;
+        }
+    };
+    typedef std::map<key, interval_set> interval_map;
+
+    /**
+     * @class file_lock
+     * @brief flock of the lock file while the object exists.
+     */
+    class file_lock {
+    public:
+        file_lock(const std::string& filename, int operation) {
+            std::string lockname = filename + ".lock";
+            fd = open(lockname.c_str(), O_RDWR | O_CREAT, 0666);
+            if (fd >= 0 && flock(fd, operation) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        ~file_lock() {
+            if (fd >= 0) {
+                flock(fd, LOCK_UN);
+                close(fd);
+            }
+        }
+        bool ok() const {
+            return fd >= 0;
+        }
+    private:
+        int fd;
+        file_lock(const file_lock&);
+        file_lock& operator=(const file_lock&);
+    };
+
+    std::string filename;
+    interval_map covered;
+    interval_map pending;
+    mutable std::mutex mtx;
+
+    static bool contains(const interval_map& map, const key& k,
+                         uint32_t seq) {
+        interval_map::const_iterator it = map.find(k);
+        if (it == map.end()) {
+            return false;
+        }
+        const interval_set& set = it->second;
+        interval_set::const_iterator p = set.upper_bound(seq);
+        if (p == set.begin()) {
+            return false;
+        }
+        --p;
+        return seq <= p->second;
+    }
+
+    /**
+     * insert [first, last] and merge overlapping or adjacent intervals.
+     */
+    static void insert(interval_map& map, const key& k, uint32_t first,
+                       uint32_t last) {
+        interval_set& set = map[k];
+        uint64_t lo = first;
+        uint64_t hi = last;
+        interval_set::iterator p = set.upper_bound(first);
+        if (p != set.begin()) {
+            --p;
+            if (static_cast<uint64_t>(p->second) + 1 >= lo) {
+                lo = p->first;
+                if (p->second > hi) {
+                    hi = p->second;
+                }
+            } else {
+                ++p;
+            }
+        }
+        while (p != set.end() && p->first <= hi + 1) {
+            if (p->second > hi) {
+                hi = p->second;
+            }
+            set.erase(p++);
+        }
+        set[static_cast<uint32_t>(lo)] = static_cast<uint32_t>(hi);
+    }
+
+    static void merge(interval_map& to, const interval_map& from) {
+        for (interval_map::const_iterator it = from.begin();
+             it != from.end(); ++it) {
+            const interval_set& set = it->second;
+            for (interval_set::const_iterator p = set.begin();
+                 p != set.end(); ++p) {
+                insert(to, it->first, p->first, p->second);
+            }
+        }
+    }
+
+    /**
+     * read lines of mexp,id,pos,first,last and
+     * mexp,id,generator,seed,start,width,first,last, generator is
+     * mixed or split. A missing file is empty.
+     */
+    bool read_file(interval_map& map) const {
+        std::ifstream ifs(filename.c_str());
+        if (!ifs) {
+            return access(filename.c_str(), F_OK) != 0;
+        }
+        std::string line;
+        while (getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            stream s;
+            std::string::size_type n = line.find(',');
+            n = (n == std::string::npos) ? n : line.find(',', n + 1);
+            if (n != std::string::npos) {
+                if (line.compare(n + 1, 6, "mixed,") == 0) {
+                    s.generator = MIXED;
+                    line.erase(n + 1, 6);
+                } else if (line.compare(n + 1, 6, "split,") == 0) {
+                    s.generator = SPLIT;
+                    line.erase(n + 1, 6);
+                }
+            }
+            // mexp, id, pos, first, last, or mexp, id, seed, start,
+            // width, first, last
+            int num = s.generator == FIXED_POS ? 5 : 7;
+            const char * p = line.c_str();
+            char * q;
+            uint64_t v[7];
+            for (int i = 0; i < num; i++) {
+                v[i] = strtoull(p, &q, 10);
+                if (q == p || (i < num - 1 && *q != ',')) {
+                    return false;
+                }
+                p = q + 1;
+            }
+            uint64_t first = v[num - 2];
+            uint64_t last = v[num - 1];
+            if (first > last || last > UINT32_MAX) {
+                return false;
+            }
+            int pos = 0;
+            if (s.generator == FIXED_POS) {
+                pos = static_cast<int>(v[2]);
+            } else {
+                s.seed = v[2];
+                s.start = static_cast<uint32_t>(v[3]);
+                s.width = static_cast<int>(v[4]);
+            }
+            insert(map, key(static_cast<int>(v[0]),
+                            static_cast<uint32_t>(v[1]), pos, s),
+                   static_cast<uint32_t>(first), static_cast<uint32_t>(last));
+        }
+        return true;
+    }
+
+    static void write(std::ostream& os, const interval_map& map) {
+        os << "# mexp, id, pos, first seq, last seq" << std::endl;
+        os << "# mexp, id, generator, seed, start seq, simd width,"
+           << " first seq, last seq" << std::endl;
+        for (interval_map::const_iterator it = map.begin();
+             it != map.end(); ++it) {
+            const key& k = it->first;
+            const interval_set& set = it->second;
+            for (interval_set::const_iterator p = set.begin();
+                 p != set.end(); ++p) {
+                os << std::dec << k.mexp << "," << k.id << ",";
+                if (k.s.generator == FIXED_POS) {
+                    os << k.pos;
+                } else {
+                    os << (k.s.generator == MIXED ? "mixed" : "split")
+                       << "," << k.s.seed << "," << k.s.start << ","
+                       << k.s.width;
+                }
+                os << "," << p->first << "," << p->second << "\n";
+            }
+        }
+    }
+
+    CoverageMap(const CoverageMap&);
+    CoverageMap& operator=(const CoverageMap&);
+};
+
+#endif // COVERAGEMAP_HPP
@@ -0,0 +1,483 @@
+#pragma once
+#ifndef M4RIEQUIDISTRIBUTION_HPP
+#define M4RIEQUIDISTRIBUTION_HPP
+/**
+ * @file M4RIEquidistribution.hpp
+ *
+ * @brief calculate dimension of equidistribution of mt64 by rank of
+ * bit-packed GF(2) matrices.
+ *
+ * Let o_0, o_1, ... be outputs of the generator. The linear map from
+ * the state space to the top v bits of o_t, ..., o_{t+k-1} is
+ * surjective if and only if the rows (t, b), 0 <= t < k, 0 <= b < v,
+ * of the matrix A[(t, b)][j] = (bit b from MSB of o_{t+j}),
+ * 0 <= j < mexp, are linearly independent, because the states after
+ * 0, 1, ..., mexp - 1 steps are a basis of the state space when the
+ * characteristic polynomial is irreducible. So k(v) is the number of
+ * complete blocks of v rows before the first row which depends on
+ * the previous rows.
+ *
+ * The first dependent row is found by Gaussian elimination which
+ * keeps the order of rows, using the Method of Four Russians: pivots
+ * are taken in groups of eight rows, a table of all 256 combinations
+ * of the group is made, and the rows below are reduced by one table
+ * look up each. The table is applied to column blocks of the rows
+ * below, so that a block of the table stays in cache.
+ *
+ * This engine is an independent check of the lattice engine, used
+ * only by calc_equidist -e m4ri. A matrix of about mexp x mexp bits
+ * is eliminated for each v, and nothing is shared between v, so the
+ * cost grows as mexp^3. All 64 v by one thread take 6 seconds for
+ * mexp 4253, 170 seconds for 9689 and 1650 seconds for 19937, which
+ * is too slow for searches, so dcmt64 always uses the lattice engine.
+ *
+ * When only some resolutions are needed, they are given as a bit
+ * mask, bit v - 1 of which means k(v). k(v) of other v are set to -1
+ * and not included in the sum of defects. The M4RI engine calculates
+ * only the requested v, and the lattice engine calculates up to the
+ * largest requested v.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <vector>
+#include <exception>
+#include <thread>
+#include <MTToolBox/AlgorithmEquidistribution.hpp>
+#include "mt64Search.hpp"
+#include "ThreadPool.hpp"
+
+namespace MTToolBox {
+    /**
+     * bit mask of all resolutions, k(1), ..., k(64)
+     */
+    const uint64_t all_resolutions = ~UINT64_C(0);
+
+    /**
+     * parse resolutions like 32,53,64 or 1-32.
+     * @param str comma separated list of v or ranges v1-v2
+     * @param mask bit v - 1 is set for each v
+     * @return false if str has error
+     */
+    inline bool parse_resolutions(const char * str, uint64_t& mask) {
+        mask = 0;
+        const char * p = str;
+        for (;;) {
+            char * q;
+            long first = strtol(p, &q, 10);
+            if (q == p) {
+                return false;
+            }
+            long last = first;
+            if (*q == '-') {
+                p = q + 1;
+                last = strtol(p, &q, 10);
+                if (q == p) {
+                    return false;
+                }
+            }
+            if (first < 1 || last > 64 || first > last) {
+                return false;
+            }
+            for (long v = first; v <= last; v++) {
+                mask |= UINT64_C(1) << (v - 1);
+            }
+            if (*q == '\0') {
+                return true;
+            }
+            if (*q != ',') {
+                return false;
+            }
+            p = q + 1;
+        }
+    }
+
+    /**
+     * @return true if k(v) is requested by resolutions
+     */
+    inline bool has_resolution(uint64_t resolutions, int v) {
+        return ((resolutions >> (v - 1)) & 1) != 0;
+    }
+
+    /**
+     * set k(v) which are not requested to -1.
+     * @param mexp mersenne exponent
+     * @param bit_len k(1), ..., k(bit_len) are in veq
+     * @param veq k(v) is in veq[v - 1]
+     * @param resolutions requested v
+     * @return sum of dimension defects of requested v
+     */
+    inline int resolution_delta(int mexp, int bit_len, int veq[],
+                                uint64_t resolutions) {
+        int delta = 0;
+        for (int v = 1; v <= bit_len; v++) {
+            if (has_resolution(resolutions, v)) {
+                delta += mexp / v - veq[v - 1];
+            } else {
+                veq[v - 1] = -1;
+            }
+        }
+        return delta;
+    }
+
+    /**
+     * @class AlgorithmM4RIEquidistribution
+     * @brief same results as AlgorithmEquidistribution for mt64
+     *
+     * Outputs of the generator are taken by generate(64), so that
+     * the reverse bit setting of the generator is respected.
+     */
+    class AlgorithmM4RIEquidistribution {
+    public:
+        /**
+         * Constructor
+         * @param g generator, its state is used as the start point.
+         * @param bit_len calculate k(1), ..., k(bit_len)
+         * @param mexp mersenne exponent
+         * @param threads number of threads, k(v) for different v are
+         * calculated in parallel. 0 means number of hardware threads.
+         * @param resolutions bit mask of v calculated
+         */
+        AlgorithmM4RIEquidistribution(const mt64& g, int bit_len, int mexp,
+                                      int threads = 1,
+                                      uint64_t resolutions
+                                      = all_resolutions) {
+            this->bit_len = bit_len;
+            this->mexp = mexp;
+            this->threads = threads;
+            this->resolutions = resolutions;
+            words = (mexp + 63) / 64;
+            // k(v) needs outputs up to o_{mexp / v + mexp}, so k(1)
+            // needs up to o_{2 mexp}
+            int min_v = 1;
+            while (min_v < bit_len && !has_resolution(resolutions, min_v)) {
+                min_v++;
+            }
+            length = mexp / min_v + mexp + 1;
+            stream_words = length / 64 + 2;
+            streams.assign(static_cast<size_t>(64) * stream_words, 0);
+            mt64 t(g);
+            // the state is in the mexp dimensional subspace after
+            // all words are renewed.
+            int size = mexp / 64 + 1;
+            for (int i = 0; i < size; i++) {
+                t.generate(64);
+            }
+            for (int i = 0; i < length; i++) {
+                uint64_t w = t.generate(64);
+                for (int b = 0; b < 64; b++) {
+                    uint64_t bit = (w >> (63 - b)) & 1;
+                    streams[b * stream_words + i / 64] |= bit << (i % 64);
+                }
+            }
+        }
+
+        /**
+         * calculate k(1), ..., k(bit_len) of requested resolutions
+         * @param veq k(v) is set to veq[v - 1], -1 if v is not requested
+         * @return sum of dimension defects d(v) of requested v
+         */
+        int get_all_equidist(int veq[]) {
+            std::vector<std::exception_ptr> errors(bit_len);
+            for (int v = 1; v <= bit_len; v++) {
+                veq[v - 1] = 0;
+            }
+            if (threads == 1 || bit_len == 1) {
+                for (int v = 1; v <= bit_len; v++) {
+                    if (has_resolution(resolutions, v)) {
+                        veq[v - 1] = get_equidist(v);
+                    }
+                }
+            } else {
+                ThreadPool pool(threads);
+                for (int v = bit_len; v >= 1; v--) {
+                    if (!has_resolution(resolutions, v)) {
+                        continue;
+                    }
+                    pool.submit([this, veq, &errors, v]() {
+                            try {
+                                veq[v - 1] = get_equidist(v);
+                            } catch (...) {
+                                errors[v - 1] = std::current_exception();
+                            }
+                        });
+                }
+                pool.wait();
+                for (int v = 1; v <= bit_len; v++) {
+                    if (errors[v - 1]) {
+                        std::rethrow_exception(errors[v - 1]);
+                    }
+                }
+            }
+            return resolution_delta(mexp, bit_len, veq, resolutions);
+        }
+
+        /**
+         * calculate k(v)
+         * @param v bit accuracy
+         * @return k(v)
+         */
+        int get_equidist(int v) const {
+            int kmax = mexp / v;
+            // (kmax + 1) * v > mexp rows are always dependent.
+            int rows = (kmax + 1) * v;
+            std::vector<uint64_t> mat(static_cast<size_t>(rows) * words);
+            for (int r = 0; r < rows; r++) {
+                get_row(&mat[static_cast<size_t>(r) * words], r / v, r % v);
+            }
+            int dep = first_dependent(mat, rows);
+            int k = dep / v;
+            if (k > kmax) {
+                k = kmax;
+            }
+            return k;
+        }
+    private:
+        enum {GROUP = 8, BLOCK = 32};
+        int bit_len;
+        int mexp;
+        int threads;
+        uint64_t resolutions;
+        int words;
+        int length;
+        int stream_words;
+        std::vector<uint64_t> streams;
+
+        /**
+         * row (t, b) is mexp bits of stream b from t.
+         */
+        void get_row(uint64_t row[], int t, int b) const {
+            const uint64_t * s = &streams[b * stream_words + t / 64];
+            int sh = t % 64;
+            for (int w = 0; w < words; w++) {
+                if (sh == 0) {
+                    row[w] = s[w];
+                } else {
+                    row[w] = (s[w] >> sh) | (s[w + 1] << (64 - sh));
+                }
+            }
+            if (mexp % 64 != 0) {
+                row[words - 1] &= (UINT64_C(1) << (mexp % 64)) - 1;
+            }
+        }
+
+        static int get_bit(const uint64_t row[], int pos) {
+            return static_cast<int>((row[pos / 64] >> (pos % 64)) & 1);
+        }
+
+        static void xor_row(uint64_t dst[], const uint64_t src[], int num) {
+            for (int w = 0; w < num; w++) {
+                dst[w] ^= src[w];
+            }
+        }
+
+        /**
+         * @return position of the lowest non zero bit, -1 if row is zero
+         */
+        int pivot_of(const uint64_t row[]) const {
+            for (int w = 0; w < words; w++) {
+                if (row[w] != 0) {
+                    int p = 0;
+                    uint64_t x = row[w];
+                    while ((x & 1) == 0) {
+                        x >>= 1;
+                        p++;
+                    }
+                    return w * 64 + p;
+                }
+            }
+            return -1;
+        }
+
+        /**
+         * Gaussian elimination which keeps the order of rows.
+         * @param mat rows x words matrix, destroyed.
+         * @param rows number of rows
+         * @return index of the first row which is a linear combination
+         * of the previous rows, rows if there is no such row.
+         */
+        int first_dependent(std::vector<uint64_t>& mat, int rows) const {
+            std::vector<uint64_t> table(static_cast<size_t>(1 << GROUP)
+                                        * words);
+            std::vector<uint8_t> index(rows);
+            int group[GROUP];
+            int pivot[GROUP];
+            int r = 0;
+            while (r < rows) {
+                // make a group of reduced rows
+                int num = 0;
+                while (num < GROUP && r < rows) {
+                    uint64_t * row = &mat[static_cast<size_t>(r) * words];
+                    for (int j = 0; j < num; j++) {
+                        if (get_bit(row, pivot[j])) {
+                            xor_row(row, &mat[static_cast<size_t>(group[j])
+                                              * words], words);
+                        }
+                    }
+                    int p = pivot_of(row);
+                    if (p < 0) {
+                        return r;
+                    }
+                    for (int j = 0; j < num; j++) {
+                        uint64_t * g = &mat[static_cast<size_t>(group[j])
+                                            * words];
+                        if (get_bit(g, p)) {
+                            xor_row(g, row, words);
+                        }
+                    }
+                    group[num] = r;
+                    pivot[num] = p;
+                    num++;
+                    r++;
+                }
+                if (r >= rows) {
+                    break;
+                }
+                // table[i] is the sum of group rows j where bit j of i is 1
+                int size = 1 << num;
+                for (int w = 0; w < words; w++) {
+                    table[w] = 0;
+                }
+                for (int i = 1; i < size; i++) {
+                    int low = 0;
+                    while (((i >> low) & 1) == 0) {
+                        low++;
+                    }
+                    uint64_t * dst = &table[static_cast<size_t>(i) * words];
+                    const uint64_t * src
+                        = &table[static_cast<size_t>(i & (i - 1)) * words];
+                    const uint64_t * g
+                        = &mat[static_cast<size_t>(group[low]) * words];
+                    for (int w = 0; w < words; w++) {
+                        dst[w] = src[w] ^ g[w];
+                    }
+                }
+                // reduce rows below by the table, column block by block
+                for (int i = r; i < rows; i++) {
+                    const uint64_t * row
+                        = &mat[static_cast<size_t>(i) * words];
+                    int idx = 0;
+                    for (int j = 0; j < num; j++) {
+                        idx |= get_bit(row, pivot[j]) << j;
+                    }
+                    index[i] = static_cast<uint8_t>(idx);
+                }
+                for (int start = 0; start < words; start += BLOCK) {
+                    int end = start + BLOCK;
+                    if (end > words) {
+                        end = words;
+                    }
+                    for (int i = r; i < rows; i++) {
+                        if (index[i] == 0) {
+                            continue;
+                        }
+                        uint64_t * row
+                            = &mat[static_cast<size_t>(i) * words];
+                        const uint64_t * t
+                            = &table[static_cast<size_t>(index[i]) * words];
+                        for (int w = start; w < end; w++) {
+                            row[w] ^= t[w];
+                        }
+                    }
+                }
+            }
+            return rows;
+        }
+    };
+
+    /**
+     * calculate dimension of equidistribution by the selected engine.
+     * @param g generator
+     * @param bit_len calculate k(1), ..., k(bit_len)
+     * @param veq k(v) is set to veq[v - 1]
+     * @param m4ri use AlgorithmM4RIEquidistribution, or
+     * AlgorithmEquidistribution (lattice reduction) if false
+     * @param threads number of threads of M4RI engine
+     * @param resolutions bit mask of v calculated, k(v) of other v
+     * are set to -1
+     * @return sum of dimension defects of requested v
+     */
+    inline int get_all_equidist(mt64& g, int bit_len, int veq[], bool m4ri,
+                                int threads = 1,
+                                uint64_t resolutions = all_resolutions) {
+        if (m4ri) {
+            AlgorithmM4RIEquidistribution equi(g, bit_len, g.getMexp(),
+                                               threads, resolutions);
+            return equi.get_all_equidist(veq);
+        }
+        int max_v = bit_len;
+        while (max_v > 1 && !has_resolution(resolutions, max_v)) {
+            max_v--;
+        }
+        bool all = true;
+        for (int v = 1; v <= max_v; v++) {
+            all = all && has_resolution(resolutions, v);
+        }
+        AlgorithmEquidistribution<uint64_t> equi(g, max_v, g.getMexp());
+        int delta = equi.get_all_equidist(veq);
+        if (all && max_v == bit_len) {
+            return delta;
+        }
+        for (int v = max_v + 1; v <= bit_len; v++) {
+            veq[v - 1] = 0;
+        }
+        return resolution_delta(g.getMexp(), bit_len, veq, resolutions);
+    }
+
+    /**
+     * calculate dimension of equidistribution from MSB and from LSB
+     * concurrently. LSB is calculated on a copy of g with reverse
+     * output in another thread.
+     * @param g generator
+     * @param bit_len calculate k(1), ..., k(bit_len)
+     * @param veq k(v) from MSB is set to veq[v - 1]
+     * @param lsb_veq k(v) from LSB is set to lsb_veq[v - 1]
+     * @param lsb_delta sum of dimension defects from LSB
+     * @param m4ri use AlgorithmM4RIEquidistribution
+     * @param threads number of threads of M4RI engine
+     * @param resolutions bit mask of v calculated
+     * @return sum of dimension defects from MSB
+     */
+    inline int get_all_equidist(mt64& g, int bit_len, int veq[],
+                                int lsb_veq[], int& lsb_delta, bool m4ri,
+                                int threads = 1,
+                                uint64_t resolutions = all_resolutions) {
+        mt64 r(g);
+        r.setReverseOutput();
+        std::exception_ptr error;
+        std::thread lsb([&]() {
+                try {
+                    lsb_delta = get_all_equidist(r, bit_len, lsb_veq, m4ri,
+                                                 threads, resolutions);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            });
+        int delta = 0;
+        try {
+            delta = get_all_equidist(g, bit_len, veq, m4ri, threads,
+                                     resolutions);
+        } catch (...) {
+            lsb.join();
+            throw;
+        }
+        lsb.join();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return delta;
+    }
+}
+
+#endif // M4RIEQUIDISTRIBUTION_HPP
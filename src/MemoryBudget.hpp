@@ -0,0 +1,207 @@
+#pragma once
+#ifndef MEMORYBUDGET_HPP
+#define MEMORYBUDGET_HPP
+/**
+ * @file MemoryBudget.hpp
+ *
+ * @brief limit of memory used by phases of searches running in
+ * parallel.
+ *
+ * Each phase, recursion search, tempering search or calculation of
+ * equidistribution, reserves its estimated working set before it
+ * starts, and waits while the reservation does not fit the limit.
+ * A phase is always admitted when nothing is reserved, so a phase
+ * larger than the limit runs alone instead of waiting forever.
+ * Phases of a thread are not nested, so waiting threads never hold
+ * reservations.
+ *
+ * The estimates follow the allocations of the code: the lattice
+ * engine keeps bit_len + 1 copies of the generator.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <condition_variable>
+#include "ThreadPool.hpp"
+
+/**
+ * @class MemoryBudget
+ * @brief bytes reserved by running phases, and the limit of them.
+ */
+class MemoryBudget {
+public:
+    /**
+     * Constructor
+     * @param limit limit in bytes, 0 means no limit
+     */
+    explicit MemoryBudget(uint64_t limit) : limit(limit) {
+        used = 0;
+        peak = 0;
+        waits = 0;
+    }
+
+    /**
+     * reserve bytes, waiting until they fit the limit.
+     * @param bytes estimated working set of a phase
+     */
+    void acquire(uint64_t bytes) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (limit > 0 && used > 0 && used + bytes > limit) {
+            waits++;
+            while (used > 0 && used + bytes > limit) {
+                cv.wait(lock);
+            }
+        }
+        used += bytes;
+        if (used > peak) {
+            peak = used;
+        }
+    }
+
+    /**
+     * @param bytes bytes reserved by acquire()
+     */
+    void release(uint64_t bytes) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            used -= bytes;
+        }
+        cv.notify_all();
+    }
+
+    /**
+     * output the limit, the peak of reservations, number of phases
+     * which waited, and max resident set size of the process.
+     * @param log output stream
+     */
+    void output(std::ostream& log) {
+        using namespace std;
+        std::unique_lock<std::mutex> lock(mtx);
+        struct rusage usage;
+        long maxrss = 0;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            maxrss = usage.ru_maxrss;   // kilobytes
+        }
+        log << "# memory: limit " << fixed << setprecision(1)
+            << limit / 1048576.0 << " MB, peak estimate "
+            << peak / 1048576.0 << " MB, max rss " << maxrss / 1024.0
+            << " MB, " << dec << waits << " phases waited" << endl;
+    }
+private:
+    uint64_t limit;
+    uint64_t used;
+    uint64_t peak;
+    long waits;
+    std::mutex mtx;
+    std::condition_variable cv;
+    MemoryBudget(const MemoryBudget&);
+    MemoryBudget& operator=(const MemoryBudget&);
+};
+
+/**
+ * @class MemoryScope
+ * @brief reservation of a phase from construction to destruction,
+ * also when the phase ends by an exception.
+ */
+class MemoryScope {
+public:
+    /**
+     * Constructor
+     * @param budget shared budget, NULL means no limit
+     * @param bytes estimated working set of the phase
+     */
+    MemoryScope(MemoryBudget * budget, uint64_t bytes) :
+        budget(budget), bytes(bytes) {
+        if (budget != 0) {
+            budget->acquire(bytes);
+        }
+    }
+
+    ~MemoryScope() {
+        if (budget != 0) {
+            budget->release(bytes);
+        }
+    }
+private:
+    MemoryBudget * budget;
+    uint64_t bytes;
+    MemoryScope(const MemoryScope&);
+    MemoryScope& operator=(const MemoryScope&);
+};
+
+/**
+ * bytes of a copy of mt64 of mexp, the state and the object.
+ */
+inline uint64_t generator_footprint(int mexp) {
+    return static_cast<uint64_t>(mexp / 64 + 1) * 8 + 256;
+}
+
+/**
+ * working set of recursion search. The polynomials of the candidate,
+ * the sequence of Berlekamp-Massey and the modulus of the test of
+ * small factors are a few dozens of polynomials of degree 2 mexp.
+ */
+inline uint64_t recursion_footprint(int mexp) {
+    return generator_footprint(mexp) + static_cast<uint64_t>(mexp) * 8;
+}
+
+/**
+ * working set of the lattice engine of AlgorithmEquidistribution,
+ * which is also used by tempering search. bit_len + 1 linear
+ * generators are kept, each of which has a copy of the generator,
+ * and the basis is copied at each reduction.
+ * @param bit_len largest v calculated
+ */
+inline uint64_t lattice_footprint(int mexp, int bit_len) {
+    return static_cast<uint64_t>(bit_len + 1) * 2
+        * generator_footprint(mexp);
+}
+
+/**
+ * working set of tempering search, which calculates equidistribution
+ * by the lattice engine.
+ * @param threads tempering candidates evaluated in parallel, 0 means
+ * hardware threads
+ */
+inline uint64_t tempering_footprint(int mexp, int threads) {
+    if (threads <= 0) {
+        threads = ThreadPool::default_threads();
+    }
+    return lattice_footprint(mexp, 64) * threads;
+}
+
+/**
+ * working set of get_all_equidist() by the lattice engine.
+ * @param resolutions bit v - 1 means k(v) is calculated
+ * @param lsb k(v) of LSB is calculated beside MSB at the same time
+ */
+inline uint64_t equidist_footprint(int mexp, uint64_t resolutions,
+                                   bool lsb) {
+    int max_v = 1;
+    for (int v = 1; v <= 64; v++) {
+        if ((resolutions >> (v - 1)) & 1) {
+            max_v = v;
+        }
+    }
+    uint64_t bytes = lattice_footprint(mexp, max_v);
+    if (lsb) {
+        bytes *= 2;
+    }
+    return bytes;
+}
+
+#endif // MEMORYBUDGET_HPP
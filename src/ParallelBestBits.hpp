@@ -0,0 +1,215 @@
+#pragma once
+#ifndef PARALLELBESTBITS_HPP
+#define PARALLELBESTBITS_HPP
+/**
+ * @file ParallelBestBits.hpp
+ *
+ * @brief tempering parameter search which decides tempering masks
+ * bit by bit from MSB, evaluating candidates in parallel.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <iostream>
+#include <vector>
+#include <exception>
+#include <MTToolBox/AlgorithmEquidistribution.hpp>
+#include "ThreadPool.hpp"
+
+namespace MTToolBox {
+    /**
+     * @class ParallelBestBits
+     * @brief same strategy as AlgorithmBestBits, but candidates are
+     * evaluated by worker threads.
+     *
+     * For v = 1, ..., limit_v, all 2^mask_num assignments of the v-th
+     * bit from MSB of tempering masks are tried, and the assignment
+     * which gives the smallest sum of dimension defects d(1) + ... +
+     * d(v) is kept. Each assignment is evaluated on a copy of the
+     * generator, so the result does not depend on the number of
+     * threads.
+     *
+     * Only 2^mask_num assignments of one bit can be evaluated at once,
+     * so with more threads the search looks ahead: the assignments of
+     * the next depth - 1 bits are evaluated together with all
+     * assignments of the current bit, and after the best assignment
+     * of the current bit is decided, the best assignment of the next
+     * bit is taken from the evaluated ones. depth is the largest d
+     * such that 2^mask_num + ... + 2^(mask_num * d) does not exceed
+     * the number of threads. The assignments which are not taken are
+     * wasted, but the masks are the same as the masks of the search
+     * bit by bit.
+     *
+     * @tparam G generator class which has setTemperingPattern(), for
+     * example mt64 with setTmpIdx(-1).
+     */
+    template<typename G>
+    class ParallelBestBits {
+    public:
+        /**
+         * Constructor
+         * @param mask_num number of tempering masks
+         * @param limit_v number of bits from MSB to be searched
+         * @param threads number of threads, 0 means number of
+         * hardware threads. Threads more than the assignments of one
+         * look ahead are not used.
+         */
+        ParallelBestBits(int mask_num, int limit_v, int threads) {
+            this->mask_num = mask_num;
+            this->limit_v = limit_v;
+            if (threads <= 0) {
+                threads = ThreadPool::default_threads();
+            }
+            depth = 1;
+            while (depth < limit_v
+                   && candidates(depth + 1) <= static_cast<long>(threads)) {
+                depth++;
+            }
+            if (threads > candidates(depth)) {
+                threads = static_cast<int>(candidates(depth));
+            }
+            this->threads = threads;
+        }
+
+        /**
+         * @return number of threads which evaluate candidates
+         */
+        int getThreads() const {
+            return threads;
+        }
+
+        /**
+         * @return number of bits decided by one look ahead
+         */
+        int getDepth() const {
+            return depth;
+        }
+
+        /**
+         * search tempering masks. Worker threads are created and
+         * joined in each call, so that per-thread counters of
+         * --profile, which are added when threads exit, are counted
+         * in the phase of the call.
+         * @param g generator whose tempering masks are set
+         * @param verbose output sum of defects of each v
+         * @return sum of dimension defects d(1) + ... + d(limit_v)
+         */
+        int operator()(G& g, bool verbose = false) {
+            const int num = 1 << mask_num;
+            ThreadPool pool(threads);
+            for (int i = 0; i < mask_num; i++) {
+                g.setTemperingPattern(~static_cast<uint64_t>(0), 0, i);
+            }
+            g.setUpTempering();
+            int delta = 0;
+            for (int v = 0; v < limit_v; ) {
+                int d = depth;
+                if (d > limit_v - v) {
+                    d = limit_v - v;
+                }
+                // deltas[k][a] is the delta of the assignments a of
+                // bits v, ..., v + k, a has k + 1 digits of base num
+                // and the digit of bit v is the most significant.
+                std::vector<std::vector<int> > deltas(d);
+                std::vector<std::vector<std::exception_ptr> > errors(d);
+                long width = 1;
+                for (int k = 0; k < d; k++) {
+                    width *= num;
+                    deltas[k].resize(width);
+                    errors[k].resize(width);
+                    for (long a = 0; a < width; a++) {
+                        pool.submit([this, &g, &deltas, &errors, k, a, v]() {
+                                try {
+                                    deltas[k][a] = evaluate(g, v, k + 1, a);
+                                } catch (...) {
+                                    errors[k][a] = std::current_exception();
+                                }
+                            });
+                    }
+                }
+                pool.wait();
+                long prefix = 0;
+                for (int k = 0; k < d; k++) {
+                    long best = prefix * num;
+                    for (long a = prefix * num; a < prefix * num + num;
+                         a++) {
+                        if (errors[k][a]) {
+                            std::rethrow_exception(errors[k][a]);
+                        }
+                        if (deltas[k][a] < deltas[k][best]) {
+                            best = a;
+                        }
+                    }
+                    set_pattern(g, static_cast<int>(best % num), v + k);
+                    delta = deltas[k][best];
+                    prefix = best;
+                    if (verbose) {
+                        std::cout << "v = " << std::dec << (v + k + 1)
+                                  << " delta = " << delta << std::endl;
+                    }
+                }
+                v += d;
+            }
+            return delta;
+        }
+    private:
+        /**
+         * @return number of assignments evaluated by a look ahead of
+         * d bits
+         */
+        long candidates(int d) const {
+            long sum = 0;
+            long width = 1;
+            for (int k = 0; k < d; k++) {
+                width <<= mask_num;
+                sum += width;
+            }
+            return sum;
+        }
+
+        /**
+         * set v-th bit from MSB of masks to the assignment c
+         */
+        void set_pattern(G& g, int c, int v) {
+            uint64_t mask = static_cast<uint64_t>(1) << (63 - v);
+            for (int i = 0; i < mask_num; i++) {
+                uint64_t pattern = ((c >> i) & 1) ? mask : 0;
+                g.setTemperingPattern(mask, pattern, i);
+            }
+            g.setUpTempering();
+        }
+
+        /**
+         * @return sum of defects up to v + bits of the assignment a of
+         * bits v, ..., v + bits - 1
+         */
+        int evaluate(const G& g, int v, int bits, long a) {
+            G t(g);
+            for (int k = bits - 1; k >= 0; k--) {
+                set_pattern(t, static_cast<int>(a % (1 << mask_num)), v + k);
+                a >>= mask_num;
+            }
+            int veq[64];
+            AlgorithmEquidistribution<uint64_t> equi(t, v + bits,
+                                                     t.getMexp());
+            return equi.get_all_equidist(veq);
+        }
+
+        int mask_num;
+        int limit_v;
+        int depth;
+        int threads;
+    };
+}
+
+#endif // PARALLELBESTBITS_HPP
@@ -0,0 +1,236 @@
+#pragma once
+#ifndef RECURSIONSEARCH_HPP
+#define RECURSIONSEARCH_HPP
+/**
+ * @file RecursionSearch.hpp
+ *
+ * @brief search parameters of recursion which have irreducible
+ * characteristic polynomial, for a concrete generator class.
+ *
+ * This does the same search as AlgorithmRecursionSearch of
+ * MTToolBox, but the generator is a template parameter, so that
+ * the state transition is not called through virtual functions.
+ * Tempering is skipped, because the minimal polynomial of a bit of
+ * the state is the same as that of outputs, and the bit sequence is
+ * packed into words of vec_GF2 directly.
+ *
+ * In algebraic mode, the characteristic polynomial is calculated from
+ * the parameters by char_poly() instead. If it is irreducible, it is
+ * equal to the minimal polynomial, so the same parameters are found.
+ *
+ * When a CoverageMap is set, candidates known to be reducible are
+ * skipped, and reducible candidates found are added to it.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <MTToolBox/ParameterGenerator.hpp>
+#include <MTToolBox/period.hpp>
+#include <NTL/GF2X.h>
+#include <NTL/vec_GF2.h>
+#include "CoverageMap.hpp"
+
+namespace MTToolBox {
+    /**
+     * @class RecursionSearch
+     * @brief search parameters whose minimal polynomial is irreducible
+     * and has degree mexp.
+     *
+     * @tparam G generator class which has setUpParam(), seed(),
+     * generateRaw() and getMexp(), for example mt64. A function
+     * char_poly(GF2X&, const G&) is also required for algebraic
+     * mode, see mt64CharPoly.hpp. getParam() which returns mexp,
+     * id, pos and seq is required when CoverageMap is used.
+     */
+    template<typename G>
+    class RecursionSearch {
+    public:
+        /**
+         * Constructor
+         * @param generator generator whose parameters are searched
+         * @param pg source of parameters
+         */
+        RecursionSearch(G& generator, ParameterGenerator& pg) :
+            rand(generator), base(pg) {
+            count = 0;
+            skipped = 0;
+            algebraic = false;
+            coverage = 0;
+        }
+
+        /**
+         * @param value use characteristic polynomial calculated from
+         * parameters, or minimal polynomial of outputs.
+         */
+        void setAlgebraic(bool value) {
+            algebraic = value;
+        }
+
+        /**
+         * @param map candidates known to be reducible, NULL means
+         * all candidates are tested.
+         * @param s stream of candidates of pg, if their pos is random
+         */
+        void setCoverage(CoverageMap * map,
+                         const CoverageMap::stream& s = CoverageMap::stream()) {
+            coverage = map;
+            coverage_stream = s;
+        }
+
+        /**
+         * search parameters.
+         * @param try_count number of candidates tried
+         * @return true if found, then the parameters are set to the
+         * generator, and it is seeded by 1.
+         */
+        bool start(int try_count) {
+            using namespace NTL;
+            long mexp = rand.getMexp();
+            for (int i = 0; i < try_count; i++) {
+                rand.setUpParam(base);
+                if (coverage != 0 && covered(rand.getParam())) {
+                    skipped++;
+                    continue;
+                }
+                count++;
+                calcPoly();
+                if (deg(poly) == mexp && !has_small_factor()
+                    && isPrime(poly)) {
+                    // tempering search uses the state, which is not
+                    // seeded by char_poly()
+                    if (algebraic) {
+                        rand.seed(1);
+                    }
+                    return true;
+                }
+                if (coverage != 0) {
+                    add_coverage(rand.getParam());
+                }
+            }
+            return false;
+        }
+
+        /**
+         * calculate the polynomial of current parameters of the
+         * generator. Its result is got by getMinPoly().
+         */
+        void calcPoly() {
+            if (algebraic) {
+                char_poly(poly, rand);
+            } else {
+                rand.seed(1);
+                minpoly_raw(rand.getMexp());
+            }
+        }
+
+        /**
+         * @return minimal polynomial of the last candidate, or
+         * characteristic polynomial in algebraic mode.
+         */
+        const NTL::GF2X& getMinPoly() const {
+            return poly;
+        }
+
+        /**
+         * @return number of candidates tried
+         */
+        long getCount() const {
+            return count;
+        }
+
+        /**
+         * @return number of candidates skipped by CoverageMap
+         */
+        long getSkipped() const {
+            return skipped;
+        }
+    private:
+        enum {SMALL_DEGREE = 16};
+        G& rand;
+        ParameterGenerator& base;
+        NTL::GF2X poly;
+        NTL::vec_GF2 seq;
+        long count;
+        long skipped;
+        bool algebraic;
+        CoverageMap * coverage;
+        CoverageMap::stream coverage_stream;
+
+        template<typename P>
+        bool covered(const P& p) const {
+            return coverage->contains(coverage_stream, p.mexp, p.id, p.pos,
+                                      p.seq);
+        }
+
+        template<typename P>
+        void add_coverage(const P& p) {
+            coverage->add(coverage_stream, p.mexp, p.id, p.pos, p.seq);
+        }
+
+        /**
+         * calculate minimal polynomial from MSB of 2 mexp words of
+         * the state.
+         */
+        void minpoly_raw(long mexp) {
+            using namespace NTL;
+            long length = 2 * mexp;
+            seq.SetLength(length);
+#if NTL_BITS_PER_LONG == 64
+            long words = (length + 63) / 64;
+            for (long w = 0; w < words; w++) {
+                uint64_t bits = 0;
+                long num = length - w * 64;
+                if (num > 64) {
+                    num = 64;
+                }
+                for (long j = 0; j < num; j++) {
+                    bits |= (rand.generateRaw() >> 63) << j;
+                }
+                seq.rep[w] = static_cast<_ntl_ulong>(bits);
+            }
+#else
+            for (long i = 0; i < length; i++) {
+                seq.put(i, static_cast<long>(rand.generateRaw() >> 63));
+            }
+#endif
+            MinPolySeq(poly, seq, mexp);
+        }
+
+        /**
+         * Most reducible polynomials have a factor of small degree,
+         * which is found by gcd(poly, x^{2^k} - x) much faster than
+         * the irreducibility test.
+         * @return true if poly has a factor of degree <= SMALL_DEGREE
+         */
+        bool has_small_factor() const {
+            using namespace NTL;
+            GF2XModulus mod(poly);
+            GF2X x;
+            GF2X t;
+            GF2X g;
+            SetX(x);
+            t = x;
+            for (int k = 1; k <= SMALL_DEGREE; k++) {
+                SqrMod(t, t, mod);
+                add(g, t, x);
+                GCD(g, g, poly);
+                if (!IsOne(g)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+#endif // RECURSIONSEARCH_HPP
@@ -0,0 +1,151 @@
+#pragma once
+#ifndef SPLITSEQUENCE_HPP
+#define SPLITSEQUENCE_HPP
+/**
+ * @file SplitSequence.hpp
+ *
+ * @brief source of candidate parameters which can be positioned at
+ * any candidate and split into disjoint ranges.
+ *
+ * Candidate k has seq = first - k, same as the count down of
+ * MixedSequence, and the random number for pos is a hash of seed and
+ * k. So candidate k is decided only by (seed, first, k), and ranges
+ * of k given to threads or processes never overlap.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdexcept>
+#include <MTToolBox/ParameterGenerator.hpp>
+
+namespace MTToolBox {
+
+    /**
+     * @class SplitSequence
+     * @brief seekable and splittable ParameterGenerator.
+     *
+     * mt64::setUpParam() calls getUint64() for pos, and then
+     * getUint32() for seq. getUint64() returns the value of the
+     * current candidate, and getUint32() moves to the next candidate.
+     * underflow_error is thrown at the end of the range, as
+     * Sequential does when seq is exhausted.
+     */
+    class SplitSequence : public ParameterGenerator {
+    public:
+        /**
+         * Constructor
+         * @param first seq of candidate 0
+         * @param seed seed of pos
+         */
+        SplitSequence(uint32_t first, uint64_t seed) {
+            this->first = first;
+            seed_hash = mix(seed);
+            begin = 0;
+            end = static_cast<uint64_t>(first) + 1;
+            index = 0;
+        }
+
+        /**
+         * @return random number for pos of the current candidate
+         */
+        uint64_t getUint64() {
+            return mix(seed_hash + (index + 1) * UINT64_C(0x9e3779b97f4a7c15));
+        }
+
+        /**
+         * @return seq of the current candidate, then move to the next
+         */
+        uint32_t getUint32() {
+            if (index >= end) {
+                throw std::underflow_error("split sequence exhausted");
+            }
+            uint32_t seq = static_cast<uint32_t>(first - index);
+            index++;
+            return seq;
+        }
+
+        void seed(uint64_t value) {
+            seed_hash = mix(value);
+        }
+
+        /**
+         * move to candidate k.
+         * @param k index of candidate
+         */
+        void seek(uint64_t k) {
+            index = k;
+        }
+
+        /**
+         * limit candidates to [start, stop) and move to start.
+         */
+        void setRange(uint64_t start, uint64_t stop) {
+            if (stop > size()) {
+                stop = size();
+            }
+            begin = start;
+            end = stop;
+            index = start;
+        }
+
+        /**
+         * limit candidates to the part-th range of num equal ranges.
+         * @param part 0 <= part < num
+         * @param num number of ranges
+         */
+        void partition(uint64_t part, uint64_t num) {
+            uint64_t total = size();
+            uint64_t q = total / num;
+            uint64_t r = total % num;
+            // the first r ranges have q + 1 candidates
+            uint64_t start = part * q + (part < r ? part : r);
+            uint64_t stop = start + q + (part < r ? 1 : 0);
+            setRange(start, stop);
+        }
+
+        /**
+         * @return number of all candidates
+         */
+        uint64_t size() const {
+            return static_cast<uint64_t>(first) + 1;
+        }
+
+        uint64_t getIndex() const {
+            return index;
+        }
+
+        uint64_t getBegin() const {
+            return begin;
+        }
+
+        uint64_t getEnd() const {
+            return end;
+        }
+    private:
+        uint32_t first;
+        uint64_t seed_hash;
+        uint64_t begin;
+        uint64_t end;
+        uint64_t index;
+
+        /**
+         * finalizer of splitmix64
+         */
+        static uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+            z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+            return z ^ (z >> 31);
+        }
+    };
+}
+#endif // SPLITSEQUENCE_HPP
@@ -0,0 +1,223 @@
+#pragma once
+#ifndef TEMPERINGTABLE_HPP
+#define TEMPERINGTABLE_HPP
+/**
+ * @file TemperingTable.hpp
+ *
+ * @brief configurations of tempering search by
+ * AlgorithmPartialBitPattern, selected at run time.
+ *
+ * AlgorithmPartialBitPattern takes the number of searched bits
+ * (limit_v) and the width of a bit pattern (step) as template
+ * parameters, so each configuration is a separate instantiation.
+ * They are listed in a table of function pointers, and one of them
+ * is selected by its name limit1:limit2:step, where limit1 and limit2
+ * are limit_v of tmsk1 and tmsk2. autotune_tempering() selects the
+ * configuration which gives the most accepted parameters per second
+ * for sample recursions.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <MTToolBox/AlgorithmPartialBitPattern.hpp>
+#include "mt64Search.hpp"
+#include "M4RIEquidistribution.hpp"
+#include "deadline.hpp"
+
+namespace MTToolBox {
+    typedef void (*tempering_stage)(mt64& g);
+
+    /**
+     * number of sample recursions of autotune_tempering()
+     */
+    enum {AUTOTUNE_SAMPLES = 3};
+
+    /**
+     * search one tempering mask.
+     * @tparam idx 0 for tmsk1, 1 for tmsk2
+     * @tparam limit number of bits searched
+     * @tparam step width of bit patterns
+     */
+    template<int idx, int limit, int step>
+    void partial_tempering(mt64& g) {
+        AlgorithmPartialBitPattern<uint64_t, 64, 1, limit, step> apbp;
+        g.setTmpIdx(idx);
+        apbp(g, false);
+    }
+
+    struct tempering_config {
+        int limit1;
+        int limit2;
+        int step;
+        tempering_stage stage1;
+        tempering_stage stage2;
+
+        const std::string name() const {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%d:%d:%d", limit1, limit2, step);
+            return buf;
+        }
+    };
+
+#define TEMPERING_CONFIG(l1, l2, s) \
+    {l1, l2, s, partial_tempering<0, l1, s>, partial_tempering<1, l2, s>}
+#define TEMPERING_STEPS(l1, l2) \
+    TEMPERING_CONFIG(l1, l2, 3), TEMPERING_CONFIG(l1, l2, 4), \
+    TEMPERING_CONFIG(l1, l2, 5), TEMPERING_CONFIG(l1, l2, 6), \
+    TEMPERING_CONFIG(l1, l2, 7), TEMPERING_CONFIG(l1, l2, 8)
+
+    /**
+     * @return table of configurations terminated by limit1 = 0.
+     * The first one, 47:27:5, is the default.
+     */
+    inline const tempering_config * tempering_table() {
+        // 47 and 27 are all bits which tmsk1 and tmsk2 can have,
+        // as tmsk1 and tmsk2 are applied after shifts of 17 and 37.
+        static const tempering_config table[] = {
+            TEMPERING_CONFIG(47, 27, 5),
+            TEMPERING_CONFIG(47, 27, 3), TEMPERING_CONFIG(47, 27, 4),
+            TEMPERING_CONFIG(47, 27, 6), TEMPERING_CONFIG(47, 27, 7),
+            TEMPERING_CONFIG(47, 27, 8),
+            TEMPERING_STEPS(40, 20),
+            TEMPERING_STEPS(32, 16),
+            {0, 0, 0, 0, 0}
+        };
+        return table;
+    }
+#undef TEMPERING_STEPS
+#undef TEMPERING_CONFIG
+
+    /**
+     * @param name limit1:limit2:step
+     * @return configuration, or NULL if name is not in the table
+     */
+    inline const tempering_config * find_tempering(const std::string& name) {
+        const tempering_config * table = tempering_table();
+        for (int i = 0; table[i].limit1 > 0; i++) {
+            if (table[i].name() == name) {
+                return &table[i];
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @return names of all configurations separated by space
+     */
+    inline const std::string tempering_names() {
+        const tempering_config * table = tempering_table();
+        std::string names;
+        for (int i = 0; table[i].limit1 > 0; i++) {
+            if (i > 0) {
+                names += " ";
+            }
+            names += table[i].name();
+        }
+        return names;
+    }
+
+    /**
+     * try all configurations for the samples, and select the one
+     * which gives the best delta per second.
+     *
+     * If max_defect accepts more samples of some configurations than
+     * of others, the one which gives the most parameters whose delta
+     * <= max_defect per second is selected. Otherwise, for example
+     * when -M is not given and all samples are accepted, acceptance
+     * says nothing about quality, and the one which gives the largest
+     * improvement of mean delta over the worst configuration per
+     * second is selected. When all mean deltas are equal, the fastest
+     * is selected.
+     * throws time_limit_error if the deadline of samples has passed.
+     * @param log output stream of results of configurations
+     * @param samples generators which have irreducible recursions
+     * @param max_defect max total defect of accepted parameters
+     * @param resolutions v of k(v) included in delta
+     * @return selected configuration
+     */
+    inline const tempering_config *
+    autotune_tempering(std::ostream& log, const std::vector<mt64>& samples,
+                       int max_defect,
+                       uint64_t resolutions = all_resolutions) {
+        using namespace std;
+        const tempering_config * table = tempering_table();
+        vector<long> accepted;
+        vector<double> mean_delta;
+        vector<double> seconds;
+        log << "# autotune: tempering, accepted, mean delta, sec" << endl;
+        for (int i = 0; table[i].limit1 > 0; i++) {
+            long count = 0;
+            long total_delta = 0;
+            double start = Deadline::now();
+            for (size_t j = 0; j < samples.size(); j++) {
+                mt64 g(samples[j]);
+                table[i].stage1(g);
+                table[i].stage2(g);
+                int veq[64];
+                int delta = get_all_equidist(g, 64, veq, false, 1,
+                                             resolutions);
+                total_delta += delta;
+                if (delta <= max_defect) {
+                    count++;
+                }
+            }
+            double sec = Deadline::now() - start;
+            if (sec <= 0) {
+                sec = 1.0e-9;
+            }
+            accepted.push_back(count);
+            mean_delta.push_back(static_cast<double>(total_delta)
+                                 / samples.size());
+            seconds.push_back(sec);
+            log << "# autotune: " << table[i].name() << ", " << dec
+                << count << ", " << fixed << setprecision(1)
+                << mean_delta.back()
+                << ", " << setprecision(3) << sec << endl;
+        }
+        size_t num = accepted.size();
+        bool by_accepted = false;
+        double worst = 0;
+        for (size_t i = 0; i < num; i++) {
+            by_accepted = by_accepted || accepted[i] != accepted[0];
+            if (mean_delta[i] > worst) {
+                worst = mean_delta[i];
+            }
+        }
+        size_t best = 0;
+        double best_score = -1;
+        for (size_t i = 0; i < num; i++) {
+            double score;
+            if (by_accepted) {
+                score = accepted[i] / seconds[i];
+            } else {
+                score = (worst - mean_delta[i]) / seconds[i];
+            }
+            // ties, like all mean deltas equal, go to the fastest
+            if (score > best_score
+                || (score == best_score && seconds[i] < seconds[best])) {
+                best = i;
+                best_score = score;
+            }
+        }
+        log << "# autotune: selected " << table[best].name() << " by "
+            << (by_accepted ? "accepted" : "delta improvement")
+            << " per second" << endl;
+        return &table[best];
+    }
+}
+#endif // TEMPERINGTABLE_HPP
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+/**
+ * @file ThreadPool.hpp
+ *
+ * @brief fixed size thread pool used by multi-threaded searches.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <deque>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @class ThreadPool
+ * @brief a fixed number of worker threads executing submitted tasks.
+ *
+ * Tasks are executed in the order of submission. Tasks should not
+ * throw exceptions; catch them in the task and record the result.
+ */
+class ThreadPool {
+public:
+    /**
+     * Constructor
+     * @param num number of worker threads. 0 means number of
+     * hardware threads.
+     */
+    explicit ThreadPool(int num) {
+        if (num <= 0) {
+            num = default_threads();
+        }
+        running = 0;
+        stop = false;
+        for (int i = 0; i < num; i++) {
+            workers.push_back(std::thread(&ThreadPool::work, this));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            stop = true;
+        }
+        task_cv.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    /**
+     * add a task to the queue.
+     * @param task task to be executed by a worker thread
+     */
+    void submit(const std::function<void()>& task) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            tasks.push_back(task);
+        }
+        task_cv.notify_one();
+    }
+
+    /**
+     * wait until all submitted tasks are finished.
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!tasks.empty() || running > 0) {
+            done_cv.wait(lock);
+        }
+    }
+
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    /**
+     * @return number of hardware threads, at least 1.
+     */
+    static int default_threads() {
+        int num = static_cast<int>(std::thread::hardware_concurrency());
+        if (num <= 0) {
+            num = 1;
+        }
+        return num;
+    }
+private:
+    void work() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                while (!stop && tasks.empty()) {
+                    task_cv.wait(lock);
+                }
+                if (tasks.empty()) {
+                    return;
+                }
+                task = tasks.front();
+                tasks.pop_front();
+                running++;
+            }
+            task();
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                running--;
+            }
+            done_cv.notify_all();
+        }
+    }
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mtx;
+    std::condition_variable task_cv;
+    std::condition_variable done_cv;
+    int running;
+    bool stop;
+};
+
+#endif // THREADPOOL_HPP
@@ -27,83 +27,223 @@
 #include <string>
 //#include <sstream>
 //#include <MTToolBox/AlgorithmRecursionAndTempering.hpp>
-#include <MTToolBox/AlgorithmBestBits.hpp>
-#include <MTToolBox/AlgorithmRecursionSearch.hpp>
 #include <MTToolBox/AlgorithmEquidistribution.hpp>
 #include <MTToolBox/AlgorithmPartialBitPattern.hpp>
 //#include <MTToolBox/MersenneTwister.hpp>
 #include "MixedSequence.hpp"
+#include "SplitSequence.hpp"
 //#include <NTL/GF2X.h>
 //#include "options.hpp"
 #include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "RecursionSearch.hpp"
+#include "M4RIEquidistribution.hpp"
+#include "profile.hpp"
+#include "CoverageMap.hpp"
+#include "MemoryBudget.hpp"
+#include "ParallelBestBits.hpp"
 #include "search.h"
+#include "stattest.h"
 
 using namespace std;
 using namespace MTToolBox;
 using namespace NTL;
 
 namespace {
-    int best_search_main(options& opt, ostream& os, ostream& log, int count);
+    int best_search_main(options& opt, ostream& os, ostream& log, int count,
+                         bool header, long& cnt, Profile * profile,
+                         CoverageMap * coverage);
 }
 
 /**
- * search parameters using all_in_one function in the file search_all.hpp
+ * search parameters, tempering parameters are searched by
+ * ParallelBestBits which uses opt.threads threads. More than 4
+ * threads look ahead the next bits of masks.
  * @param opt command line options
  * @param count number of parameters user requested
+ * @param header output header line or not
  * @return 0 if this ends normally
  */
-int best_search(options& opt, ostream& os, ostream& log, int count) {
+int best_search(options& opt, ostream& os, ostream& log, int count,
+                bool header) {
+    long cnt = 0;
+    const char * status = "complete";
+    Profile prof(opt.profile);
+    CoverageMap cov(opt.coverage_file);
+    CoverageMap * coverage = opt.coverage;
+    if (coverage == 0 && !opt.coverage_file.empty()) {
+        if (cov.load()) {
+            coverage = &cov;
+        } else {
+            log << "# coverage: can't read " << opt.coverage_file << endl;
+        }
+    }
     try {
-        return best_search_main(opt, os, log, count);
+        best_search_main(opt, os, log, count, header, cnt,
+                         opt.profile ? &prof : 0,
+                         coverage);
     } catch (underflow_error &e) {
         log << "# search end: sequence has wasted out." << endl;
-        return 0;
+        status = "exhausted";
+    } catch (time_limit_error &e) {
+        log << "# search end: time limit exceeded." << endl;
+        status = "time-limit";
+    }
+    if (opt.time_limit > 0) {
+        output_status(os, opt, cnt, count, status);
     }
+    if (coverage != 0 && !coverage->save()) {
+        log << "# coverage: can't write " << opt.coverage_file << endl;
+    }
+    if (opt.profile) {
+        prof.output(log);
+    }
+    return 0;
 }
 
 namespace {
-    int best_search_main(options& opt, ostream& os, ostream& log, int count) {
+    int best_search_main(options& opt, ostream& os, ostream& log, int count,
+                         bool header, long& cnt, Profile * profile,
+                         CoverageMap * coverage) {
         uint32_t seq = 0;
         seq = ~seq;
         if (opt.seq > 0) {
             seq = opt.seq;
         }
         MixedSequence mx(seq, opt.seed, 0);
+        SplitSequence sp(seq, opt.seed);
+        ParameterGenerator * pg = &mx;
+        if (opt.part_count > 0) {
+            sp.partition(opt.part_index, opt.part_count);
+            pg = &sp;
+        }
         mt64 g(opt.mexp, opt.id);
-        static const int shifts[] = {17, 37};
         //limit_v 何ビットテンパリングするか とりあえず 15のまま
-        AlgorithmBestBits<uint64_t> besttmp(64, shifts, 2, 15);
+        ParallelBestBits<mt64> besttmp(2, 15, opt.threads);
         if (opt.verbose) {
             time_t t = time(NULL);
             log << "#search start id = " << opt.id << " at " << ctime(&t) << endl;
             log << "#seed = " << dec << opt.seed
                 << ", seq = " << seq << endl;
+            if (opt.part_count > 0) {
+                log << "#partition = " << opt.part_index << "/"
+                    << opt.part_count << ", candidates = ["
+                    << sp.getBegin() << ", " << sp.getEnd() << ")" << endl;
+            }
         }
         if (opt.fixedPOS > 0) {
             g.setFixedPOS(opt.fixedPOS);
         }
+        if (opt.simd_pos > 0) {
+            g.setSimdPos(opt.simd_pos);
+        }
+        Deadline deadline(opt.deadline);
+        g.setDeadline(deadline.flag());
         g.setTmpIdx(-1);
-        AlgorithmRecursionSearch<uint64_t> ars(g, mx);
-        long cnt = 0;
-        os << "# " << g.getHeaderString() << ", delta"
-           << endl;
+        RecursionSearch<mt64> ars(g, *pg);
+        ars.setAlgebraic(opt.charpoly == "algebraic");
+        ars.setCoverage(coverage, coverage_stream(opt, seq));
+        cnt = 0;
+        if (header) {
+            output_header(os, opt);
+        }
         while (cnt < count) {
-            if (ars.start(opt.logcount)) {
+            long before = ars.getCount();
+            long skipped = ars.getSkipped();
+            double start = Deadline::now();
+            bool found;
+            {
+                MemoryScope memory(opt.memory,
+                                   recursion_footprint(opt.mexp));
+                ProfileScope scope(profile, "recursion");
+                found = ars.start(opt.logcount);
+            }
+            if (opt.verbose) {
+                log << "# recursion search: " << dec
+                    << (ars.getCount() - before) << " candidates, "
+                    << fixed << setprecision(3)
+                    << (Deadline::now() - start) << " sec" << endl;
+                if (coverage != 0) {
+                    log << "# coverage: " << dec
+                        << (ars.getSkipped() - skipped)
+                        << " candidates skipped, "
+                        << coverage->intervals() << " intervals" << endl;
+                }
+            }
+            if (coverage != 0 && !coverage->save()) {
+                log << "# coverage: can't write " << opt.coverage_file
+                    << endl;
+            }
+            if (found) {
                 log << "# search found: " << dec << g.getID()
                     << ", " << g.getSEQ()
                     << "; tempering search start..." << endl;
-                besttmp(g, false);
-                AlgorithmEquidistribution<uint64_t> equi(g, 64, opt.mexp);
+                start = Deadline::now();
+                {
+                    MemoryScope memory(opt.memory,
+                                       tempering_footprint(
+                                           opt.mexp, besttmp.getThreads()));
+                    ProfileScope scope(profile, "tempering");
+                    besttmp(g, false);
+                }
+                if (opt.verbose) {
+                    log << "# tempering time: " << fixed << setprecision(3)
+                        << (Deadline::now() - start) << " sec" << endl;
+                }
                 int veq[64];
-                int delta = equi.get_all_equidist(veq);
+                int lsb_veq[64];
+                int delta;
+                int lsb_delta = 0;
+                bool lsb = opt.max_lsb_defect >= 0;
+                {
+                    MemoryScope memory(opt.memory,
+                                       equidist_footprint(opt.mexp,
+                                                          opt.resolutions,
+                                                          lsb));
+                    ProfileScope scope(profile, "equidistribution");
+                    if (lsb) {
+                        delta = get_all_equidist(g, 64, veq, lsb_veq,
+                                                 lsb_delta, false, 1,
+                                                 opt.resolutions);
+                    } else {
+                        delta = get_all_equidist(g, 64, veq, false, 1,
+                                                 opt.resolutions);
+                    }
+                }
                 if (delta > opt.max_defect) {
                     log << "# search skipped: " << dec << g.getID()
                         << ", " << g.getSEQ()
                         << "; dd = " << delta << endl;
                     continue;
                 }
+                if (opt.max_lsb_defect >= 0
+                    && lsb_delta > opt.max_lsb_defect) {
+                    log << "# search skipped: " << dec << g.getID()
+                        << ", " << g.getSEQ()
+                        << "; lsb dd = " << lsb_delta << endl;
+                    continue;
+                }
                 os << g.getParamString();
-                os << "," << dec << delta << endl;
+                os << "," << dec << delta;
+                if (opt.max_lsb_defect >= 0) {
+                    os << "," << dec << lsb_delta;
+                }
+                if (opt.simd_pos > 0) {
+                    output_speed(os, opt, g.getParam());
+                }
+                if (opt.poly) {
+                    os << "," << poly_to_hex(ars.getMinPoly());
+                }
+                os << endl;
+                if (opt.stat_tests) {
+                    vector<stat_result> results;
+                    stat_test(results, g.getParam(), opt.seed,
+                              opt.stat_tests);
+                    log << "# stat test: " << dec << g.getID()
+                        << ", " << g.getSEQ() << "; ";
+                    output_stat_test(log, results);
+                    log << endl;
+                }
 #if defined(DEBUG)
                 for (int j = 0; j < 64; j++) {
                     cout << "k(" << dec << (j + 1) << ") = " << dec << veq[j];
@@ -1,4 +1,6 @@
 #include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "M4RIEquidistribution.hpp"
 #include <MTToolBox/AlgorithmEquidistribution.hpp>
 #include <MTToolBox/AlgorithmReducibleRecursionSearch.hpp>
 #include <MTToolBox/period.hpp>
@@ -6,6 +8,12 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include "ThreadPool.hpp"
+#include "stattest.h"
 
 using namespace MTToolBox;
 using namespace std;
@@ -15,14 +23,25 @@ public:
     bool verbose;
     bool reverse;
     bool period;
+    bool m4ri;
+    bool lsb;
     uint64_t seed;
-    mt64_param params;
+    int stat_tests;
+    int threads;
+    uint64_t resolutions;
+    string filename;
+    vector<mt64_param> params;
+    vector<NTL::GF2X> polys;    // stored polynomials, zero if none
 };
 
 namespace {
     bool parse_opt(options& opt, int argc, char **argv);
     void output_help(string& pgm);
-    bool check_period(mt64& mt);
+    bool check_period(ostream& os, mt64& mt, const GF2X& stored);
+    bool calc_equidist(ostream& os, const options& opt,
+                       const mt64_param& params, const GF2X& poly,
+                       int threads);
+    bool read_param_file(options& opt);
 }
 
 
@@ -32,34 +51,121 @@ int main(int argc, char * argv[])
     if (!parse_opt(opt, argc, argv)) {
         return -1;
     }
-    mt64 mt(opt.params);
-    mt.seed(opt.seed);
-    if (opt.period) {
-        if (check_period(mt)) {
+    size_t num = opt.params.size();
+    if (num == 1) {
+        if (calc_equidist(cout, opt, opt.params[0], opt.polys[0],
+                          opt.threads)) {
             return 0;
         } else {
             return -1;
         }
     }
-    int delta = 0;
-    int veq[64];
-    AlgorithmEquidistribution<uint64_t> equi(mt, 64, opt.params.mexp);
-    delta = equi.get_all_equidist(veq);
-    cout << mt.getParamString();
-    cout << "," << dec << delta << endl;
-    if (opt.verbose) {
-        cout << "64bit dimension of equidistribution at v-bit accuracy k(v)"
-             << endl;
-        for (int j = 0; j < 64; j++) {
-            cout << "k(" << dec << (j + 1) << ") = " << dec << veq[j];
-            cout << "\td(" << dec << (j + 1) << ") = " << dec
-                 << (opt.params.mexp / (j + 1) - veq[j]) << endl;
-        }
+    // many parameters are calculated in parallel, and outputted
+    // in the order of input.
+    vector<string> results(num);
+    vector<bool> done(num, false);
+    size_t next = 0;
+    bool ok = true;
+    mutex mtx;
+    ThreadPool pool(opt.threads);
+    for (size_t i = 0; i < num; i++) {
+        pool.submit([&, i]() {
+                stringstream ss;
+                if (opt.period) {
+                    ss << opt.params[i].get_string() << endl;
+                }
+                bool r = calc_equidist(ss, opt, opt.params[i],
+                                       opt.polys[i], 1);
+                unique_lock<mutex> lock(mtx);
+                ok = ok && r;
+                results[i] = ss.str();
+                done[i] = true;
+                while (next < num && done[next]) {
+                    cout << results[next];
+                    cout.flush();
+                    results[next].clear();
+                    next++;
+                }
+            });
+    }
+    pool.wait();
+    if (ok) {
+        return 0;
+    } else {
+        return -1;
     }
-    return 0;
 }
 
 namespace {
+    /**
+     * calculate dimension of equidistribution, or check period,
+     * of one parameter.
+     * @param os output stream
+     * @param opt command line options
+     * @param params parameter of mt64
+     * @param poly polynomial stored with the parameter, or zero
+     * @param threads number of threads of m4ri engine
+     * @return false if period check fails
+     */
+    bool calc_equidist(ostream& os, const options& opt,
+                       const mt64_param& params, const GF2X& poly,
+                       int threads) {
+        mt64 mt(params);
+        mt.seed(opt.seed);
+        if (opt.period) {
+            return check_period(os, mt, poly);
+        }
+        int delta = 0;
+        int veq[64];
+        int lsb_delta = 0;
+        int lsb_veq[64];
+        if (opt.lsb) {
+            delta = get_all_equidist(mt, 64, veq, lsb_veq, lsb_delta,
+                                     opt.m4ri, threads, opt.resolutions);
+        } else {
+            delta = get_all_equidist(mt, 64, veq, opt.m4ri, threads,
+                                     opt.resolutions);
+        }
+        os << mt.getParamString();
+        os << "," << dec << delta;
+        if (opt.lsb) {
+            os << "," << dec << lsb_delta;
+        }
+        if (opt.stat_tests) {
+            vector<stat_result> results;
+            stat_test(results, params, opt.seed, opt.stat_tests);
+            os << ",";
+            output_stat_test(os, results);
+        }
+        os << endl;
+        if (opt.verbose) {
+            os << "64bit dimension of equidistribution at v-bit accuracy k(v)"
+               << endl;
+            for (int j = 0; j < 64; j++) {
+                if (veq[j] < 0) {
+                    continue;
+                }
+                os << "k(" << dec << (j + 1) << ") = " << dec << veq[j];
+                os << "\td(" << dec << (j + 1) << ") = " << dec
+                   << (params.mexp / (j + 1) - veq[j]) << endl;
+            }
+            if (opt.lsb) {
+                os << "64bit dimension of equidistribution at v-bit accuracy"
+                   << " from LSB k(v)" << endl;
+                for (int j = 0; j < 64; j++) {
+                    if (lsb_veq[j] < 0) {
+                        continue;
+                    }
+                    os << "k(" << dec << (j + 1) << ") = " << dec
+                       << lsb_veq[j];
+                    os << "\td(" << dec << (j + 1) << ") = " << dec
+                       << (params.mexp / (j + 1) - lsb_veq[j]) << endl;
+                }
+            }
+        }
+        return true;
+    }
+
     /**
      * command line option parser
      * @param opt a structure to keep the result of parsing
@@ -71,7 +177,13 @@ namespace {
     bool parse_opt(options& opt, int argc, char **argv) {
         opt.verbose = false;
         opt.period = false;
+        opt.m4ri = false;
+        opt.lsb = false;
         opt.seed = 0;
+        opt.stat_tests = 0;
+        opt.threads = 0;
+        opt.resolutions = all_resolutions;
+        opt.filename = "";
         int c;
         bool error = false;
         string pgm = argv[0];
@@ -79,10 +191,16 @@ namespace {
             {"verbose", no_argument, NULL, 'v'},
             {"period", no_argument, NULL, 'p'},
             {"seed", required_argument, NULL, 's'},
+            {"file", required_argument, NULL, 'f'},
+            {"threads", required_argument, NULL, 't'},
+            {"stat-test", optional_argument, NULL, 'T'},
+            {"engine", required_argument, NULL, 'e'},
+            {"lsb", no_argument, NULL, 'l'},
+            {"resolutions", required_argument, NULL, 'V'},
             {NULL, 0, NULL, 0}};
         errno = 0;
         for (;;) {
-            c = getopt_long(argc, argv, "vps:", longopts, NULL);
+            c = getopt_long(argc, argv, "vps:f:t:T::e:lV:", longopts, NULL);
             if (error) {
                 break;
             }
@@ -97,9 +215,45 @@ namespace {
                     cerr << "seed must be a number" << endl;
                 }
                 break;
+            case 'f':
+                opt.filename = optarg;
+                break;
+            case 't':
+                opt.threads = strtol(optarg, NULL, 10);
+                if (errno || opt.threads < 0) {
+                    error = true;
+                    cerr << "threads must be a non negative number" << endl;
+                }
+                break;
+            case 'T':
+                if (!parse_stat_tests(optarg, opt.stat_tests)) {
+                    error = true;
+                    cerr << "unknown statistical test" << endl;
+                }
+                break;
+            case 'e':
+                if (string(optarg) == "m4ri") {
+                    opt.m4ri = true;
+                } else if (string(optarg) == "lattice") {
+                    opt.m4ri = false;
+                } else {
+                    error = true;
+                    cerr << "engine must be lattice or m4ri" << endl;
+                }
+                break;
             case 'v':
                 opt.verbose = true;
                 break;
+            case 'l':
+                opt.lsb = true;
+                break;
+            case 'V':
+                if (!parse_resolutions(optarg, opt.resolutions)) {
+                    error = true;
+                    cerr << "resolutions must be a list of 1 to 64, like"
+                         << " 32,53,64 or 1-32" << endl;
+                }
+                break;
             case 'p':
                 opt.period = true;
                 break;
@@ -111,21 +265,22 @@ namespace {
         }
         argc -= optind;
         argv += optind;
-        if (argc < 1) {
+        for (int i = 0; i < argc; i++) {
+            mt64_param params;
+            if (!params.parse(argv[i])) {
+                cerr << "wrong parameter:" << argv[i] << endl;
+                error = true;
+                break;
+            }
+            opt.params.push_back(params);
+            opt.polys.push_back(GF2X());
+            parse_poly(opt.polys.back(), argv[i], params.mexp);
+        }
+        if (!error && !opt.filename.empty()) {
+            error = !read_param_file(opt);
+        }
+        if (opt.params.empty()) {
             error = true;
-        } else {
-            char * para = argv[0];
-            opt.params.mexp = strtoul(para, &para, 10);
-            para++;
-            opt.params.id = strtoul(para, &para, 10);
-            para++;
-            opt.params.pos = strtoul(para, &para, 10);
-            para++;
-            opt.params.mat = strtoull(para, &para, 16);
-            para++;
-            opt.params.tmsk1 = strtoull(para, &para, 16);
-            para++;
-            opt.params.tmsk2 = strtoull(para, &para, 16);
         }
         if (error) {
             output_help(pgm);
@@ -133,6 +288,26 @@ namespace {
         }
         return true;
     }
+
+    /**
+     * read parameter lines from file. lines start with # are skipped.
+     * @param opt parameters are added to opt.params
+     * @return false if file can't be read
+     */
+    bool read_param_file(options& opt) {
+        ifstream ifs(opt.filename.c_str());
+        if (!ifs) {
+            cerr << "can't open file:" << opt.filename << endl;
+            return false;
+        }
+        string bad;
+        if (!read_params(ifs, opt.params, opt.polys, bad)) {
+            cerr << "wrong parameter:" << bad << endl;
+            return false;
+        }
+        return true;
+    }
+
     /**
      * showing help message
      * @param pgm program name
@@ -141,31 +316,64 @@ namespace {
     {
         cerr << "usage:" << endl;
         cerr << pgm
-             << " [-v] [-s seed] [-p]"
-             << " mexp,pos,mat,tmsk1,tmsk2"
+             << " [-v] [-s seed] [-p] [-l] [-T[tests]] [-t threads]"
+             << " [-e engine] [-V resolutions]"
+             << " [-f file] [mexp,id,pos,mat,tmsk1,tmsk2 ...]"
              << endl;
         static string help_string1 = "\n"
             "--verbose, -v        Verbose mode. Output detailed information.\n"
-            "--period, -p         period chek only.\n"
+            "--period, -p         period chek only. when the characteristic\n"
+            "                     polynomial is stored in the parameter line by\n"
+            "                     dcmt64 --poly, it is checked that the polynomial\n"
+            "                     annihilates the generator, instead of calculating\n"
+            "                     minimal polynomial.\n"
+            "--lsb, -l            calculate dimension of equidistribution from LSB,\n"
+            "                     too. total defect from LSB is outputted after\n"
+            "                     total defect from MSB.\n"
             "--seed, -s seed      seed for generation.\n"
+            "--file, -f file      read parameters from file, which is the output\n"
+            "                     of dcmt64.\n"
+            "--threads, -t num    number of threads used when many parameters are\n"
+            "                     given, or by m4ri engine. default is number of\n"
+            "                     hardware threads.\n"
+            "--engine, -e engine  lattice (default) or m4ri. m4ri calculates\n"
+            "                     dimension of equidistribution by rank of GF(2)\n"
+            "                     matrices, to cross check lattice. it is much\n"
+            "                     slower for large mexp, and dcmt64 does not use\n"
+            "                     it.\n"
+            "--resolutions, -V list\n"
+            "                     calculate k(v) only for v in list, like\n"
+            "                     32,53,64 or 1-32. delta is the sum of defects of\n"
+            "                     these v. default is 1-64.\n"
+            "--stat-test[=tests]  apply statistical tests and output p-values.\n"
+            "                     tests is comma separated list of lincomp,\n"
+            "                     bspace and rank. default is all.\n"
             ;
         cerr << help_string1 << endl;
     }
 
-    bool check_period(mt64& mt)
+    bool check_period(ostream& os, mt64& mt, const GF2X& stored)
     {
         GF2X poly;
-        minpoly<uint64_t>(poly, mt);
-        cout << "deg(poly) = " << dec << deg(poly) << endl;
+        if (IsZero(stored)) {
+            minpoly<uint64_t>(poly, mt);
+        } else if (annihilates(stored, mt)) {
+            poly = stored;
+            os << "stored poly annihilates generator." << endl;
+        } else {
+            os << "stored poly does not annihilate generator. NG." << endl;
+            return false;
+        }
+        os << "deg(poly) = " << dec << deg(poly) << endl;
         if (deg(poly) != mt.getMexp()) {
-            cout << "deg(poly) is not mexp. NG." << endl;
+            os << "deg(poly) is not mexp. NG." << endl;
             return false;
         }
         if (isPrime(poly)) {
-            cout << "poly is prime. OK." << endl;
+            os << "poly is prime. OK." << endl;
             return true;
         } else {
-            cout << "poly is not prime. NG." << endl;
+            os << "poly is not prime. NG." << endl;
             return false;
         }
     }
@@ -0,0 +1,547 @@
+/**
+ * @file campaign.cpp
+ *
+ * @brief search parameters for several mersenne exponents in one
+ * process.
+ *
+ * A campaign file lists targets, mexp, ids and count of parameters.
+ * The cost of a candidate of recursion search grows steeply with mexp,
+ * so the seconds per candidate of each mexp are measured before the
+ * search, and the cost of a task, which is one id of a target, is
+ * estimated as count * mexp * (seconds per candidate), because about
+ * one of mexp candidates is irreducible.
+ *
+ * All tasks are scheduled on one thread pool, the task of the largest
+ * estimated cost first, so that all targets finish together. When a
+ * task ends, its actual time corrects the estimates of the remaining
+ * tasks of the same mexp, which include tempering search and rejected
+ * parameters. Progress and ETA are outputted to log periodically.
+ * Outputs of tasks are flushed in the order of the campaign file.
+ * With --simd-pos and several threads, outputs are kept until all
+ * tasks end, and speeds are measured then.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <stdexcept>
+#include <time.h>
+#include "MixedSequence.hpp"
+#include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "RecursionSearch.hpp"
+#include "ThreadPool.hpp"
+#include "deadline.hpp"
+#include "search.h"
+
+using namespace std;
+using namespace MTToolBox;
+
+namespace {
+    /**
+     * number of candidates of recursion search measured for each mexp
+     */
+    enum {CALIBRATION_CANDIDATES = 8};
+
+    /**
+     * seconds between progress reports
+     */
+    const double REPORT_INTERVAL = 60;
+
+    struct target {
+        int mexp;
+        int64_t first;
+        int64_t last;
+        long count;
+    };
+
+    struct task {
+        size_t target;          // index of targets
+        int64_t id;
+        int mexp;
+        double estimate;        // seconds estimated before the search
+        double start;           // Deadline::now() at start, 0 if waiting
+        double elapsed;         // seconds, if done
+        bool done;
+        string out;
+        string log;
+    };
+
+    /**
+     * @class campaign_state
+     * @brief tasks of a campaign shared by worker threads.
+     */
+    class campaign_state {
+    public:
+        campaign_state(ostream& os, ostream& log, vector<task>& tasks,
+                       int threads) :
+            os(os), log(log), tasks(tasks), threads(threads) {
+            next = 0;
+            finished = 0;
+            done_sec = 0;
+            stop = false;
+        }
+
+        /**
+         * @return true if parameters and logs go to the same stream
+         */
+        bool combined() const {
+            return &os == &log;
+        }
+
+        /**
+         * take the waiting task of the largest estimated cost.
+         * @param i index of the task
+         * @return false if no task is waiting
+         */
+        bool take(size_t& i) {
+            unique_lock<mutex> lock(mtx);
+            double max = -1;
+            for (size_t j = 0; j < tasks.size(); j++) {
+                if (tasks[j].start == 0 && !tasks[j].done
+                    && corrected(tasks[j]) > max) {
+                    max = corrected(tasks[j]);
+                    i = j;
+                }
+            }
+            if (max < 0) {
+                return false;
+            }
+            tasks[i].start = Deadline::now();
+            return true;
+        }
+
+        /**
+         * keep the result of task i, and output results of tasks whose
+         * previous tasks are all outputted.
+         */
+        void finish(size_t i, const string& out, const string& lg,
+                    bool verbose) {
+            unique_lock<mutex> lock(mtx);
+            task& t = tasks[i];
+            t.elapsed = Deadline::now() - t.start;
+            t.done = true;
+            t.out = out;
+            t.log = lg;
+            actual[t.mexp] += t.elapsed;
+            estimated[t.mexp] += t.estimate;
+            finished++;
+            done_sec += t.elapsed;
+            while (next < tasks.size() && tasks[next].done) {
+                if (!combined()) {
+                    log << tasks[next].log;
+                    log.flush();
+                }
+                os << tasks[next].out;
+                os.flush();
+                tasks[next].out.clear();
+                tasks[next].log.clear();
+                next++;
+            }
+            if (verbose) {
+                report_locked();
+            }
+        }
+
+        /**
+         * output progress and ETA to log every interval seconds until
+         * stop_monitor() is called.
+         */
+        void monitor(double interval) {
+            using namespace std::chrono;
+            unique_lock<mutex> lock(mtx);
+            while (!stop) {
+                if (cv.wait_for(lock, duration<double>(interval))
+                    == cv_status::timeout && !stop) {
+                    report_locked();
+                }
+            }
+        }
+
+        void stop_monitor() {
+            {
+                unique_lock<mutex> lock(mtx);
+                stop = true;
+            }
+            cv.notify_all();
+        }
+
+        /**
+         * @param mexp mersenne exponent
+         * @param act seconds of finished tasks of mexp
+         * @param est seconds estimated for them
+         */
+        void get_actual(int mexp, double& act, double& est) {
+            unique_lock<mutex> lock(mtx);
+            act = actual[mexp];
+            est = estimated[mexp];
+        }
+    private:
+        ostream& os;
+        ostream& log;
+        vector<task>& tasks;
+        int threads;
+        size_t next;
+        size_t finished;
+        double done_sec;
+        bool stop;
+        map<int, double> actual;
+        map<int, double> estimated;
+        mutex mtx;
+        condition_variable cv;
+
+        /**
+         * @return estimate of task corrected by finished tasks of the
+         * same mexp, or of all mexp if none of the mexp has finished.
+         */
+        double corrected(const task& t) {
+            double act = actual[t.mexp];
+            double est = estimated[t.mexp];
+            if (est <= 0) {
+                act = 0;
+                est = 0;
+                for (map<int, double>::iterator it = estimated.begin();
+                     it != estimated.end(); ++it) {
+                    act += actual[it->first];
+                    est += it->second;
+                }
+            }
+            if (est <= 0) {
+                return t.estimate;
+            }
+            return t.estimate * act / est;
+        }
+
+        /**
+         * output number of finished tasks, share of the work done and
+         * seconds to the end. The end is estimated by the remaining
+         * work divided by threads, but not before the end of the
+         * longest remaining task.
+         */
+        void report_locked() {
+            double now = Deadline::now();
+            double remaining = 0;
+            double longest = 0;
+            for (size_t j = 0; j < tasks.size(); j++) {
+                const task& t = tasks[j];
+                if (t.done) {
+                    continue;
+                }
+                double rest = corrected(t);
+                if (t.start > 0) {
+                    rest -= now - t.start;
+                    if (rest < 0) {
+                        rest = 0;
+                    }
+                }
+                remaining += rest;
+                if (rest > longest) {
+                    longest = rest;
+                }
+            }
+            double eta = remaining / threads;
+            if (eta < longest) {
+                eta = longest;
+            }
+            double total = done_sec + remaining;
+            log << "# campaign: " << dec << finished << "/" << tasks.size()
+                << " tasks, " << fixed << setprecision(1)
+                << (total > 0 ? 100 * done_sec / total : 100.0)
+                << "% of work, eta " << setprecision(0) << eta << " sec"
+                << endl;
+            log.flush();
+        }
+    };
+
+    bool read_targets(const options& opt, vector<target>& targets);
+    double candidate_seconds(const options& opt);
+    void run_tasks(const vector<options>& target_opts,
+                   const vector<target>& targets, vector<task>& tasks,
+                   search_func func, bool verbose, campaign_state& state,
+                   atomic<int>& rc);
+}
+
+/**
+ * search parameters for all targets in the file opt.campaign_file.
+ * @param opt command line options
+ * @param os output stream of parameters
+ * @param log output stream of logs
+ * @param func search function applied to each id
+ * @return 0 if all searches end normally
+ */
+int campaign(options& opt, ostream& os, ostream& log, search_func func) {
+    vector<target> targets;
+    if (!read_targets(opt, targets)) {
+        return -1;
+    }
+    ThreadPool pool(opt.threads);
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        log << "#campaign start " << dec << targets.size()
+            << " targets, threads = " << pool.size()
+            << " at " << ctime(&t) << endl;
+    }
+    output_header(os, opt);
+    // options and cost model of each target
+    vector<options> target_opts;
+    vector<task> tasks;
+    map<int, double> cand_sec;
+    log << "# campaign: mexp, ids, count, sec/candidate, estimated sec"
+        << endl;
+    for (size_t i = 0; i < targets.size(); i++) {
+        const target& tg = targets[i];
+        options topt = opt;
+        topt.mexp = tg.mexp;
+        topt.id = tg.first;
+        topt.last_id = -1;
+        topt.campaign_file = "";
+        if (topt.logcount <= 0) {
+            topt.logcount = tg.mexp / 2;
+        }
+        if (func == search) {
+            select_tempering(topt, log);
+        }
+        if (cand_sec.find(tg.mexp) == cand_sec.end()) {
+            cand_sec[tg.mexp] = candidate_seconds(topt);
+        }
+        double estimate = static_cast<double>(tg.count) * tg.mexp
+            * cand_sec[tg.mexp];
+        for (int64_t id = tg.first; id <= tg.last; id++) {
+            task t;
+            t.target = i;
+            t.id = id;
+            t.mexp = tg.mexp;
+            t.estimate = estimate;
+            t.start = 0;
+            t.elapsed = 0;
+            t.done = false;
+            tasks.push_back(t);
+        }
+        log << "# campaign: " << dec << tg.mexp << ", " << tg.first << ":"
+            << tg.last << ", " << tg.count << ", " << scientific
+            << setprecision(3) << cand_sec[tg.mexp] << ", " << fixed
+            << setprecision(1) << estimate * (tg.last - tg.first + 1)
+            << endl;
+        target_opts.push_back(topt);
+    }
+    // speeds measured by a worker are disturbed by other workers
+    bool defer = opt.simd_pos > 0 && pool.size() > 1;
+    ostringstream held;
+    ostream& campaign_os = defer ? held : os;
+    ostream& campaign_log = (defer && &os == &log) ? held : log;
+    for (size_t i = 0; i < target_opts.size(); i++) {
+        target_opts[i].defer_speed = defer;
+    }
+    campaign_state state(campaign_os, campaign_log, tasks, pool.size());
+    thread reporter(&campaign_state::monitor, &state, REPORT_INTERVAL);
+    atomic<int> rc(0);
+    bool verbose = opt.verbose;
+    for (int i = 0; i < pool.size(); i++) {
+        pool.submit([&target_opts, &targets, &tasks, func, verbose, &state,
+                     &rc]() {
+                run_tasks(target_opts, targets, tasks, func, verbose, state,
+                          rc);
+            });
+    }
+    pool.wait();
+    state.stop_monitor();
+    reporter.join();
+    if (defer) {
+        os << fill_speed(held.str());
+        os.flush();
+    }
+    // actual time of each mexp, which tells the error of the model
+    log << "# campaign end: mexp, estimated sec, actual sec" << endl;
+    for (map<int, double>::iterator it = cand_sec.begin();
+         it != cand_sec.end(); ++it) {
+        double act;
+        double est;
+        state.get_actual(it->first, act, est);
+        log << "# campaign end: " << dec << it->first << ", " << fixed
+            << setprecision(1) << est << ", " << act << endl;
+    }
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        log << "campaign end at " << ctime(&t) << endl;
+    }
+    return rc;
+}
+
+namespace {
+    /**
+     * parse a line mexp,id,count or mexp,start:end,count. count may
+     * be omitted, then count of the command line is used.
+     * @return false if the line is wrong
+     */
+    bool parse_target(const options& opt, const string& line, target& tg) {
+        const char * p = line.c_str();
+        char * q;
+        errno = 0;
+        tg.mexp = strtol(p, &q, 10);
+        if (errno || q == p || *q != ',') {
+            return false;
+        }
+        p = q + 1;
+        tg.first = strtoll(p, &q, 0);
+        if (errno || q == p) {
+            return false;
+        }
+        tg.last = tg.first;
+        if (*q == ':') {
+            p = q + 1;
+            tg.last = strtoll(p, &q, 0);
+            if (errno || q == p) {
+                return false;
+            }
+        }
+        tg.count = opt.count;
+        if (*q == ',') {
+            p = q + 1;
+            tg.count = strtol(p, &q, 10);
+            if (errno || q == p) {
+                return false;
+            }
+        }
+        while (*q == ' ' || *q == '\t' || *q == '\r') {
+            q++;
+        }
+        if (*q != '\0') {
+            return false;
+        }
+        return is_allowed_mexp(tg.mexp) && tg.first >= 0
+            && tg.first <= tg.last && tg.last < INT64_C(0x100000000)
+            && tg.count > 0;
+    }
+
+    /**
+     * read targets. Lines which start with # are skipped.
+     * @return false if file can't be read or has a wrong line
+     */
+    bool read_targets(const options& opt, vector<target>& targets) {
+        ifstream ifs(opt.campaign_file.c_str());
+        if (!ifs) {
+            cerr << "can't open file:" << opt.campaign_file << endl;
+            return false;
+        }
+        string line;
+        while (getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            target tg;
+            if (!parse_target(opt, line, tg)) {
+                cerr << "wrong target:" << line << endl;
+                cerr << "target must be mexp,id[:last_id][,count]" << endl;
+                return false;
+            }
+            int size = tg.mexp / 64 + 1;
+            if (opt.fixedPOS >= size
+                || (opt.simd_pos > 0 && size < 2 * opt.simd_pos)) {
+                cerr << "fixed-pos or simd-pos is too large for mexp "
+                     << dec << tg.mexp << endl;
+                return false;
+            }
+            targets.push_back(tg);
+        }
+        if (targets.empty()) {
+            cerr << "no target in file:" << opt.campaign_file << endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * measure seconds per candidate of recursion search of opt.mexp.
+     * Candidates are taken from another sequence than the search, as
+     * select_tempering() does.
+     * @return seconds per candidate
+     */
+    double candidate_seconds(const options& opt) {
+        uint32_t seq = ~static_cast<uint32_t>(0);
+        if (opt.seq > 0) {
+            seq = opt.seq;
+        }
+        MixedSequence mx(seq, opt.seed ^ UINT64_C(0x6a09e667f3bcc909), 0);
+        mt64 g(opt.mexp, opt.id);
+        if (opt.fixedPOS > 0) {
+            g.setFixedPOS(opt.fixedPOS);
+        }
+        if (opt.simd_pos > 0) {
+            g.setSimdPos(opt.simd_pos);
+        }
+        Deadline deadline(opt.deadline);
+        g.setDeadline(deadline.flag());
+        RecursionSearch<mt64> rs(g, mx);
+        rs.setAlgebraic(opt.charpoly == "algebraic");
+        double start = Deadline::now();
+        try {
+            for (int i = 0; i < CALIBRATION_CANDIDATES; i++) {
+                rs.start(1);
+            }
+        } catch (time_limit_error& e) {
+            // the search ends soon, the estimate does not matter
+        } catch (underflow_error& e) {
+            // a small start seq, the search ends soon as well
+        }
+        double sec = Deadline::now() - start;
+        if (rs.getCount() == 0) {
+            return sec;
+        }
+        return sec / rs.getCount();
+    }
+
+    /**
+     * take tasks one by one and search parameters of them.
+     */
+    void run_tasks(const vector<options>& target_opts,
+                   const vector<target>& targets, vector<task>& tasks,
+                   search_func func, bool verbose, campaign_state& state,
+                   atomic<int>& rc) {
+        size_t i;
+        while (state.take(i)) {
+            const task& t = tasks[i];
+            options id_opt = target_opts[t.target];
+            id_opt.id = t.id;
+            id_opt.threads = 1;
+            ostringstream out;
+            ostringstream lg;
+            ostream& id_log = state.combined() ? out : lg;
+            int r;
+            try {
+                r = func(id_opt, out, id_log, targets[t.target].count,
+                         false);
+            } catch (exception& e) {
+                id_log << "# search error: " << dec << t.mexp << ", "
+                       << t.id << ", " << e.what() << endl;
+                r = -1;
+            }
+            if (r != 0) {
+                rc = r;
+            }
+            state.finish(i, out.str(), lg.str(), verbose);
+        }
+    }
+}
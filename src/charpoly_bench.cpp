@@ -0,0 +1,207 @@
+/**
+ * @file charpoly_bench.cpp
+ *
+ * @brief compare the characteristic polynomial calculated from
+ * parameters with the minimal polynomial by Berlekamp-Massey.
+ *
+ * For each mersenne exponent, the same candidates are given to both
+ * modes of RecursionSearch. The minimal polynomial must divide the
+ * characteristic polynomial, and they must be equal when the degree
+ * of the minimal polynomial is mexp. Average time per candidate of
+ * both modes is outputted.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <NTL/GF2X.h>
+#include "MixedSequence.hpp"
+#include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "RecursionSearch.hpp"
+#include "options.h"
+
+using namespace std;
+using namespace MTToolBox;
+using namespace NTL;
+
+class bench_options {
+public:
+    int mexp;
+    long count;
+    uint64_t seed;
+};
+
+namespace {
+    bool parse_opt(bench_options& opt, int argc, char **argv);
+    void output_help(string& pgm);
+    bool bench(ostream& os, int mexp, long count, uint64_t seed);
+}
+
+int main(int argc, char * argv[])
+{
+    bench_options opt;
+    if (!parse_opt(opt, argc, argv)) {
+        return -1;
+    }
+    cout << "# mexp, candidates, bm usec, algebraic usec, speedup,"
+         << " full degree, mismatch" << endl;
+    bool ok = true;
+    if (opt.mexp > 0) {
+        ok = bench(cout, opt.mexp, opt.count, opt.seed);
+    } else {
+        for (int i = 0; allowed_mexp[i] > 0; i++) {
+            ok = bench(cout, allowed_mexp[i], opt.count, opt.seed) && ok;
+        }
+    }
+    return ok ? 0 : -1;
+}
+
+namespace {
+    /**
+     * @return true if there is no mismatch
+     */
+    bool bench(ostream& os, int mexp, long count, uint64_t seed) {
+        MixedSequence mx(~static_cast<uint32_t>(0), seed, 0);
+        mt64 g(mexp, 0);
+        RecursionSearch<mt64> rs(g, mx);
+        GF2X minpoly;
+        GF2X charpoly;
+        GF2X r;
+        double bm_time = 0;
+        double alg_time = 0;
+        long full = 0;
+        long mismatch = 0;
+        for (long i = 0; i < count; i++) {
+            g.setUpParam(mx);
+            rs.setAlgebraic(false);
+            double start = Deadline::now();
+            rs.calcPoly();
+            bm_time += Deadline::now() - start;
+            minpoly = rs.getMinPoly();
+            rs.setAlgebraic(true);
+            start = Deadline::now();
+            rs.calcPoly();
+            alg_time += Deadline::now() - start;
+            charpoly = rs.getMinPoly();
+            if (deg(minpoly) == mexp) {
+                full++;
+                if (minpoly != charpoly) {
+                    mismatch++;
+                }
+            } else {
+                rem(r, charpoly, minpoly);
+                if (!IsZero(r)) {
+                    mismatch++;
+                }
+            }
+            if (deg(charpoly) != mexp) {
+                mismatch++;
+            }
+        }
+        os << dec << mexp << ", " << count << ", "
+           << fixed << setprecision(2)
+           << (bm_time / count * 1.0e6) << ", "
+           << (alg_time / count * 1.0e6) << ", "
+           << setprecision(1) << (bm_time / alg_time) << ", "
+           << full << ", " << mismatch << endl;
+        return mismatch == 0;
+    }
+
+    /**
+     * command line option parser
+     * @param opt a structure to keep the result of parsing
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     * @return command line options have error, or not
+     */
+    bool parse_opt(bench_options& opt, int argc, char **argv) {
+        opt.mexp = 0;
+        opt.count = 100;
+        opt.seed = 1;
+        int c;
+        bool error = false;
+        string pgm = argv[0];
+        static struct option longopts[] = {
+            {"mexp", required_argument, NULL, 'm'},
+            {"count", required_argument, NULL, 'c'},
+            {"seed", required_argument, NULL, 's'},
+            {NULL, 0, NULL, 0}};
+        errno = 0;
+        for (;;) {
+            c = getopt_long(argc, argv, "m:c:s:", longopts, NULL);
+            if (error) {
+                break;
+            }
+            if (c == -1) {
+                break;
+            }
+            switch (c) {
+            case 'm':
+                opt.mexp = strtol(optarg, NULL, 10);
+                if (errno || !is_allowed_mexp(opt.mexp)) {
+                    error = true;
+                    cerr << "mexp is not supported" << endl;
+                }
+                break;
+            case 'c':
+                opt.count = strtol(optarg, NULL, 10);
+                if (errno || opt.count <= 0) {
+                    error = true;
+                    cerr << "count must be a positive number" << endl;
+                }
+                break;
+            case 's':
+                opt.seed = strtoull(optarg, NULL, 0);
+                if (errno) {
+                    error = true;
+                    cerr << "seed must be a number" << endl;
+                }
+                break;
+            case '?':
+            default:
+                error = true;
+                break;
+            }
+        }
+        if (error) {
+            output_help(pgm);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * showing help message
+     * @param pgm program name
+     */
+    void output_help(string& pgm)
+    {
+        cerr << "usage:" << endl;
+        cerr << pgm << " [-m mexp] [-c count] [-s seed]" << endl;
+        static string help_string1 = "\n"
+            "--mexp, -m mexp      mersenne exponent. default is all supported\n"
+            "                     exponents.\n"
+            "--count, -c count    number of candidates of each mexp.\n"
+            "                     default is 100.\n"
+            "--seed, -s seed      seed of candidates.\n"
+            ;
+        cerr << help_string1 << endl;
+    }
+}
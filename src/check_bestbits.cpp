@@ -0,0 +1,91 @@
+/**
+ * @file check_bestbits.cpp
+ *
+ * @brief check that ParallelBestBits gives the same tempering masks as
+ * AlgorithmBestBits of MTToolBox, run by make check.
+ *
+ * A recursion of each mexp is searched, and its tempering masks are
+ * searched by AlgorithmBestBits(64, {17, 37}, 2, 15), which dcmt64
+ * used before, and by ParallelBestBits(2, 15, threads) with numbers of
+ * threads which make look ahead of depth 1, 2 and 3. Masks and total
+ * dimension defects must be the same.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <iostream>
+#include <iomanip>
+#include <MTToolBox/AlgorithmBestBits.hpp>
+#include <MTToolBox/AlgorithmEquidistribution.hpp>
+#include "MixedSequence.hpp"
+#include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "RecursionSearch.hpp"
+#include "ParallelBestBits.hpp"
+
+using namespace MTToolBox;
+using namespace std;
+
+namespace {
+    int total_defect(mt64& g) {
+        AlgorithmEquidistribution<uint64_t> equi(g, 64, g.getMexp());
+        int veq[64];
+        return equi.get_all_equidist(veq);
+    }
+}
+
+int main()
+{
+    static const int mexps[] = {521, 607, 1279, 2203};
+    static const int threads[] = {1, 4, 20, 84};
+    static const int shifts[] = {17, 37};
+    int rc = 0;
+    cout << "# mexp, id, pos, threads, depth, tmsk1, tmsk2, delta"
+         << endl;
+    for (size_t i = 0; i < sizeof(mexps) / sizeof(mexps[0]); i++) {
+        mt64 g(mexps[i], 0);
+        g.setTmpIdx(-1);
+        MixedSequence mx(~static_cast<uint32_t>(0), 1234, 0);
+        RecursionSearch<mt64> rs(g, mx);
+        while (!rs.start(mexps[i])) {
+        }
+        mt64 expect(g);
+        AlgorithmBestBits<uint64_t> besttmp(64, shifts, 2, 15);
+        besttmp(expect, false);
+        int expect_delta = total_defect(expect);
+        const mt64_param& ep = expect.getParam();
+        for (size_t j = 0; j < sizeof(threads) / sizeof(threads[0]); j++) {
+            mt64 t(g);
+            ParallelBestBits<mt64> parallel(2, 15, threads[j]);
+            parallel(t, false);
+            int delta = total_defect(t);
+            const mt64_param& tp = t.getParam();
+            bool ok = tp.tmsk1 == ep.tmsk1 && tp.tmsk2 == ep.tmsk2
+                && delta == expect_delta;
+            cout << dec << tp.mexp << ", " << tp.id << ", " << tp.pos
+                 << ", " << parallel.getThreads()
+                 << ", " << parallel.getDepth() << ", "
+                 << hex << setw(16) << setfill('0') << tp.tmsk1 << ", "
+                 << hex << setw(16) << setfill('0') << tp.tmsk2 << ", "
+                 << dec << delta << (ok ? " ok" : " NG") << endl;
+            if (!ok) {
+                cout << "# AlgorithmBestBits: "
+                     << hex << setw(16) << setfill('0') << ep.tmsk1 << ", "
+                     << hex << setw(16) << setfill('0') << ep.tmsk2 << ", "
+                     << dec << expect_delta << endl;
+                rc = 1;
+            }
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,334 @@
+/**
+ * @file check_indep.cpp
+ *
+ * @brief check that characteristic polynomials of parameters in a
+ * table are pairwise coprime.
+ *
+ * The minimal polynomial of each parameter is calculated once, or the
+ * characteristic polynomial stored in the parameter line by dcmt64
+ * --poly is used after checking that it annihilates the generator, and
+ * the coprimality of all pairs is checked by the batch gcd method:
+ * the product tree of all polynomials is calculated, then the
+ * remainder tree gives (P / p_i) mod p_i for each polynomial p_i,
+ * where P is the product of all polynomials. p_i has a common factor
+ * with another polynomial if and only if gcd(p_i, (P / p_i) mod p_i)
+ * is not 1. Only such polynomials are compared pairwise to report
+ * colliding pairs.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include <MTToolBox/period.hpp>
+#include <NTL/GF2X.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <getopt.h>
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "ThreadPool.hpp"
+
+using namespace MTToolBox;
+using namespace NTL;
+using namespace std;
+
+class options {
+public:
+    bool verbose;
+    uint64_t seed;
+    int threads;
+    string filename;
+    vector<mt64_param> params;
+    vector<GF2X> stored;        // stored polynomials, zero if none
+};
+
+namespace {
+    bool parse_opt(options& opt, int argc, char **argv);
+    void output_help(string& pgm);
+    bool read_param_file(options& opt);
+    void parallel_for(ThreadPool& pool, size_t num,
+                      const function<void(size_t)>& func);
+    void batch_gcd(ThreadPool& pool, vector<GF2X>& gcds,
+                   const vector<GF2X>& polys);
+    void log_time(const options& opt, const char * msg);
+}
+
+int main(int argc, char * argv[])
+{
+    options opt;
+    if (!parse_opt(opt, argc, argv)) {
+        return -1;
+    }
+    size_t num = opt.params.size();
+    ThreadPool pool(opt.threads);
+    vector<GF2X> polys(num);
+    log_time(opt, "minimal polynomial start");
+    atomic<long> reused(0);
+    parallel_for(pool, num, [&](size_t i) {
+            mt64 mt(opt.params[i]);
+            mt.seed(opt.seed);
+            if (!IsZero(opt.stored[i]) && annihilates(opt.stored[i], mt)) {
+                polys[i] = opt.stored[i];
+                reused++;
+                return;
+            }
+            mt.seed(opt.seed);
+            minpoly<uint64_t>(polys[i], mt);
+        });
+    if (opt.verbose) {
+        cout << "# stored polynomials: " << dec << reused.load() << endl;
+    }
+    log_time(opt, "batch gcd start");
+    vector<GF2X> gcds(num);
+    batch_gcd(pool, gcds, polys);
+    log_time(opt, "batch gcd end");
+    vector<size_t> suspects;
+    for (size_t i = 0; i < num; i++) {
+        if (deg(gcds[i]) > 0) {
+            suspects.push_back(i);
+        }
+    }
+    long pairs = 0;
+    cout << "# parameters: " << dec << num << endl;
+    cout << "# suspects: " << dec << suspects.size() << endl;
+    for (size_t a = 0; a < suspects.size(); a++) {
+        for (size_t b = a + 1; b < suspects.size(); b++) {
+            size_t i = suspects[a];
+            size_t j = suspects[b];
+            GF2X g;
+            GCD(g, polys[i], polys[j]);
+            if (deg(g) > 0) {
+                cout << opt.params[i].get_string() << " "
+                     << opt.params[j].get_string()
+                     << " deg(gcd) = " << dec << deg(g) << endl;
+                pairs++;
+            }
+        }
+    }
+    cout << "# colliding pairs: " << dec << pairs << endl;
+    if (pairs == 0) {
+        return 0;
+    } else {
+        return -1;
+    }
+}
+
+namespace {
+    /**
+     * call func(0), ..., func(num - 1) by worker threads of pool.
+     */
+    void parallel_for(ThreadPool& pool, size_t num,
+                      const function<void(size_t)>& func) {
+        atomic<size_t> next(0);
+        for (int t = 0; t < pool.size(); t++) {
+            pool.submit([&]() {
+                    for (;;) {
+                        size_t i = next++;
+                        if (i >= num) {
+                            break;
+                        }
+                        func(i);
+                    }
+                });
+        }
+        pool.wait();
+    }
+
+    /**
+     * batch gcd
+     * @param pool worker threads
+     * @param gcds gcd(p_i, (P / p_i) mod p_i) for each i
+     * @param polys polynomials p_i
+     */
+    void batch_gcd(ThreadPool& pool, vector<GF2X>& gcds,
+                   const vector<GF2X>& polys) {
+        size_t num = polys.size();
+        if (num < 2) {
+            for (size_t i = 0; i < num; i++) {
+                set(gcds[i]);
+            }
+            return;
+        }
+        // product tree, tree[0] is leaves and tree.back() is root
+        vector<vector<GF2X> > tree;
+        tree.push_back(polys);
+        while (tree.back().size() > 1) {
+            const vector<GF2X>& low = tree.back();
+            vector<GF2X> up((low.size() + 1) / 2);
+            parallel_for(pool, up.size(), [&](size_t i) {
+                    if (2 * i + 1 < low.size()) {
+                        mul(up[i], low[2 * i], low[2 * i + 1]);
+                    } else {
+                        up[i] = low[2 * i];
+                    }
+                });
+            tree.push_back(up);
+        }
+        // remainder tree, P mod (node)^2 from root to leaves
+        vector<GF2X> rems(tree.back());
+        for (int h = static_cast<int>(tree.size()) - 2; h >= 0; h--) {
+            const vector<GF2X>& node = tree[h];
+            vector<GF2X> next(node.size());
+            parallel_for(pool, node.size(), [&](size_t i) {
+                    GF2X sq;
+                    sqr(sq, node[i]);
+                    rem(next[i], rems[i / 2], sq);
+                });
+            rems.swap(next);
+            if (h > 0) {
+                tree.pop_back();
+            }
+        }
+        parallel_for(pool, num, [&](size_t i) {
+                GF2X q;
+                div(q, rems[i], polys[i]);
+                GCD(gcds[i], polys[i], q);
+            });
+    }
+
+    void log_time(const options& opt, const char * msg) {
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "# " << msg << " at " << ctime(&t);
+        }
+    }
+
+    /**
+     * command line option parser
+     * @param opt a structure to keep the result of parsing
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     * @return command line options have error, or not
+     */
+    bool parse_opt(options& opt, int argc, char **argv) {
+        opt.verbose = false;
+        opt.seed = 0;
+        opt.threads = 0;
+        opt.filename = "";
+        int c;
+        bool error = false;
+        string pgm = argv[0];
+        static struct option longopts[] = {
+            {"verbose", no_argument, NULL, 'v'},
+            {"seed", required_argument, NULL, 's'},
+            {"file", required_argument, NULL, 'f'},
+            {"threads", required_argument, NULL, 't'},
+            {NULL, 0, NULL, 0}};
+        errno = 0;
+        for (;;) {
+            c = getopt_long(argc, argv, "vs:f:t:", longopts, NULL);
+            if (error) {
+                break;
+            }
+            if (c == -1) {
+                break;
+            }
+            switch (c) {
+            case 's':
+                opt.seed = strtoull(optarg, NULL, 0);
+                if (errno) {
+                    error = true;
+                    cerr << "seed must be a number" << endl;
+                }
+                break;
+            case 'f':
+                opt.filename = optarg;
+                break;
+            case 't':
+                opt.threads = strtol(optarg, NULL, 10);
+                if (errno || opt.threads < 0) {
+                    error = true;
+                    cerr << "threads must be a non negative number" << endl;
+                }
+                break;
+            case 'v':
+                opt.verbose = true;
+                break;
+            case '?':
+            default:
+                error = true;
+                break;
+            }
+        }
+        argc -= optind;
+        argv += optind;
+        for (int i = 0; i < argc; i++) {
+            mt64_param params;
+            if (!params.parse(argv[i])) {
+                cerr << "wrong parameter:" << argv[i] << endl;
+                error = true;
+                break;
+            }
+            opt.params.push_back(params);
+            opt.stored.push_back(GF2X());
+            parse_poly(opt.stored.back(), argv[i], params.mexp);
+        }
+        if (!error && !opt.filename.empty()) {
+            error = !read_param_file(opt);
+        }
+        if (opt.params.empty()) {
+            error = true;
+        }
+        if (error) {
+            output_help(pgm);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * read parameter lines from file.
+     * @param opt parameters are added to opt.params
+     * @return false if file can't be read
+     */
+    bool read_param_file(options& opt) {
+        ifstream ifs(opt.filename.c_str());
+        if (!ifs) {
+            cerr << "can't open file:" << opt.filename << endl;
+            return false;
+        }
+        string bad;
+        if (!read_params(ifs, opt.params, opt.stored, bad)) {
+            cerr << "wrong parameter:" << bad << endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * showing help message
+     * @param pgm program name
+     */
+    void output_help(string& pgm)
+    {
+        cerr << "usage:" << endl;
+        cerr << pgm
+             << " [-v] [-s seed] [-t threads] [-f file]"
+             << " [mexp,id,pos,mat,tmsk1,tmsk2 ...]"
+             << endl;
+        static string help_string1 = "\n"
+            "--verbose, -v        Verbose mode. Output calculation time.\n"
+            "--seed, -s seed      seed for generation.\n"
+            "--file, -f file      read parameters from file, which is the output\n"
+            "                     of dcmt64.\n"
+            "--threads, -t num    number of threads. default is number of\n"
+            "                     hardware threads.\n"
+            "\n"
+            "Pairs of parameters whose minimal polynomials are not coprime\n"
+            "are outputted. Exit status is not zero if such pairs exist.\n"
+            ;
+        cerr << help_string1 << endl;
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file check_multi.cpp
+ *
+ * @brief check that lanes of mt64_multi generate the same sequences as
+ * mt64, run by make check.
+ *
+ * For several mexp, lanes have different pos, mat and tempering
+ * masks, and numbers of lanes are not multiples of the vector width,
+ * so padding lanes are used. Each lane is compared with
+ * mt64::generate() of the same parameter and seed, for outputs of
+ * next() and fill(), over several refills of the state.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <iostream>
+#include <vector>
+#include "mt64Search.hpp"
+#include "mt64Runtime.hpp"
+
+using namespace MTToolBox;
+using namespace std;
+
+namespace {
+    /**
+     * splitmix64, source of parameters of lanes
+     */
+    uint64_t next_random(uint64_t& x) {
+        uint64_t z = (x += UINT64_C(0x9e3779b97f4a7c15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * parameters of lanes, pos of lane i covers 1 to size - 1.
+     */
+    void make_params(vector<mt64_param>& params, int mexp, int lanes,
+                     uint64_t& x) {
+        int size = mexp / 64 + 1;
+        params.resize(lanes);
+        for (int i = 0; i < lanes; i++) {
+            mt64_param& p = params[i];
+            p.mexp = mexp;
+            p.id = i;
+            p.pos = 1 + i % (size - 1);
+            p.mat = next_random(x);
+            p.tmsk1 = next_random(x);
+            p.tmsk2 = next_random(x);
+        }
+    }
+
+    /**
+     * @return number of lanes which differ from mt64
+     */
+    int check(int mexp, int lanes, uint64_t& x) {
+        vector<mt64_param> params;
+        make_params(params, mexp, lanes, x);
+        long rows = 3L * (mexp / 64 + 1) + 7;
+        uint64_t seed = next_random(x);
+        vector<uint64_t> seeds(lanes);
+        for (int i = 0; i < lanes; i++) {
+            seeds[i] = seed + i;
+        }
+        // next() with seeds of each lane, fill() with seed + i
+        mt64_multi by_next(&params[0], lanes);
+        by_next.seed(&seeds[0]);
+        vector<uint64_t> next_out(rows * lanes);
+        for (long r = 0; r < rows; r++) {
+            const uint64_t * p = by_next.next();
+            for (int i = 0; i < lanes; i++) {
+                next_out[r * lanes + i] = p[i];
+            }
+        }
+        mt64_multi by_fill(&params[0], lanes);
+        by_fill.seed(seed);
+        vector<uint64_t> fill_out(rows * lanes);
+        by_fill.fill(&fill_out[0], rows);
+        int wrong = 0;
+        for (int i = 0; i < lanes; i++) {
+            mt64 g(params[i]);
+            g.seed(seeds[i]);
+            for (long r = 0; r < rows; r++) {
+                uint64_t expect = g.generate();
+                if (next_out[r * lanes + i] != expect
+                    || fill_out[r * lanes + i] != expect) {
+                    cout << "mexp = " << dec << mexp << ", lanes = " << lanes
+                         << ", lane " << i << " (pos = " << params[i].pos
+                         << ") differs at output " << r << endl;
+                    wrong++;
+                    break;
+                }
+            }
+        }
+        return wrong;
+    }
+}
+
+int main()
+{
+    static const int mexps[] = {521, 607, 1279, 2203, 4253, 19937};
+    static const int lanes[] = {1, 3, 5, 7, 9, 13, 17};
+    uint64_t x = 1234;
+    int wrong = 0;
+    for (size_t i = 0; i < sizeof(mexps) / sizeof(mexps[0]); i++) {
+        for (size_t j = 0; j < sizeof(lanes) / sizeof(lanes[0]); j++) {
+            wrong += check(mexps[i], lanes[j], x);
+        }
+    }
+    if (wrong != 0) {
+        cout << dec << wrong << " lanes differ from mt64" << endl;
+        return 1;
+    }
+    cout << "mt64_multi: all lanes are same as mt64" << endl;
+    return 0;
+}
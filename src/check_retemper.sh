@@ -0,0 +1,43 @@
+#!/bin/sh
+# check of dcmt64 --retemper, run by make check.
+#
+# The generator of an entry must be seeded before tempering search,
+# otherwise k(v) of the zero state is calculated. MT19937-64, whose
+# total defect is 7820, is retempered, and
+# 1. calc_equidist gives delta 7820 for MT19937-64 itself,
+# 2. delta outputted by retemper equals delta of the retempered
+#    parameter calculated by calc_equidist,
+# 3. retempering the result again gives the same tempering and delta.
+srcdir=${srcdir:-.}
+known=$srcdir/mt19937-64.txt
+tmp=${TMPDIR:-/tmp}/check_retemper.$$
+trap 'rm -f $tmp.*' 0
+
+param=`grep -v '^#' $known | cut -d, -f1-6`
+expect=`grep -v '^#' $known | cut -d, -f7`
+delta=`./calc_equidist "$param" | grep -v '^#' | cut -d, -f7`
+if [ "$delta" != "$expect" ]; then
+    echo "calc_equidist: delta of MT19937-64 is $delta, not $expect"
+    exit 1
+fi
+
+./dcmt64 --retemper $known -f $tmp.1 --logfile $tmp.log || exit 1
+./dcmt64 --retemper $tmp.1 -f $tmp.2 --logfile $tmp.log || exit 1
+line1=`grep -v '^#' $tmp.1`
+line2=`grep -v '^#' $tmp.2`
+if [ -z "$line1" ] || [ "$line1" != "$line2" ]; then
+    echo "retemper is not reproducible:"
+    echo "$line1"
+    echo "$line2"
+    exit 1
+fi
+param=`echo "$line1" | cut -d, -f1-6`
+delta=`echo "$line1" | cut -d, -f7`
+check=`./calc_equidist "$param" | grep -v '^#' | cut -d, -f7`
+if [ "$delta" != "$check" ]; then
+    echo "retemper: delta is $delta, calc_equidist gives $check"
+    echo "$line1"
+    exit 1
+fi
+echo "retemper: $line1"
+exit 0
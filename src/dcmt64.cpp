@@ -34,6 +34,7 @@
 #include <NTL/GF2X.h>
 #include <getopt.h>
 #include "mt64Search.hpp"
+#include "MemoryBudget.hpp"
 #include "search.h"
 #include "options.h"
 
@@ -77,6 +78,27 @@ int main(int argc, char** argv) {
     } else {
         ls = os;
     }
-    return search(opt, *os, *ls, opt.count);
-    //return best_search(opt, *os, *ls, opt.count);
+    // shared by all threads of the search
+    MemoryBudget budget(opt.memory_limit);
+    if (opt.memory_limit > 0) {
+        opt.memory = &budget;
+    }
+    search_func func = search;
+    if (opt.algorithm == "best") {
+        func = best_search;
+    }
+    int rc;
+    if (!opt.retemper_file.empty()) {
+        rc = retemper(opt, *os, *ls);
+    } else if (!opt.campaign_file.empty()) {
+        rc = campaign(opt, *os, *ls, func);
+    } else if (opt.last_id >= 0) {
+        rc = search_range(opt, *os, *ls, opt.count, func);
+    } else {
+        rc = func(opt, *os, *ls, opt.count, true);
+    }
+    if (opt.memory_limit > 0) {
+        budget.output(*ls);
+    }
+    return rc;
 }
@@ -0,0 +1,340 @@
+/**
+ * @file dcmt64_codegen.cpp
+ *
+ * @brief generate a C++ header of a generator specialized to one
+ * parameter of 64 bit Mersenne Twister.
+ *
+ * The generated header does not depend on any other file. Parameters
+ * are constexpr constants, the state has fixed size, and the block
+ * refill is unrolled with constant indices, so that compilers can
+ * fold the recurrence and tempering. The generator produces the same
+ * sequence as the class mt64 in mt64Search.hpp.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include "mt64Search.hpp"
+#include <errno.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <getopt.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace MTToolBox;
+using namespace std;
+
+class options {
+public:
+    int unroll;
+    string name;
+    string outfilename;
+    mt64_param param;
+};
+
+namespace {
+    bool parse_opt(options& opt, int argc, char **argv);
+    void output_help(string& pgm);
+    void output_header(ostream& os, const options& opt);
+    void output_loop(ostream& os, int unroll, int start, int end,
+                     int offset, int next);
+    string hex64(uint64_t x);
+    string index_expr(int k);
+}
+
+int main(int argc, char * argv[])
+{
+    options opt;
+    if (!parse_opt(opt, argc, argv)) {
+        return -1;
+    }
+    if (opt.outfilename.empty()) {
+        output_header(cout, opt);
+        return 0;
+    }
+    ofstream ofs(opt.outfilename.c_str());
+    if (!ofs) {
+        cerr << "can't open file:" << opt.outfilename << endl;
+        return -1;
+    }
+    output_header(ofs, opt);
+    return 0;
+}
+
+namespace {
+    string hex64(uint64_t x) {
+        ostringstream ss;
+        ss << "UINT64_C(0x" << hex << setw(16) << setfill('0') << x << ")";
+        return ss.str();
+    }
+
+    /**
+     * @return "i + k" or "i - k"
+     */
+    string index_expr(int k) {
+        ostringstream ss;
+        ss << "i";
+        if (k > 0) {
+            ss << " + " << dec << k;
+        } else if (k < 0) {
+            ss << " - " << dec << -k;
+        }
+        return ss.str();
+    }
+
+    /**
+     * output the header.
+     * @param os output stream
+     * @param opt options
+     */
+    void output_header(ostream& os, const options& opt) {
+        const mt64_param& p = opt.param;
+        int size = p.mexp / 64 + 1;
+        uint64_t lower_mask = ~UINT64_C(0) >> (p.mexp % 64);
+        string guard;
+        for (size_t i = 0; i < opt.name.size(); i++) {
+            guard += static_cast<char>(toupper(opt.name[i]));
+        }
+        guard += "_HPP";
+        os << "#pragma once\n"
+           << "#ifndef " << guard << "\n"
+           << "#define " << guard << "\n"
+           << "/**\n"
+           << " * @file " << opt.name << ".hpp\n"
+           << " *\n"
+           << " * @brief 64 bit Mersenne Twister specialized to the parameter\n"
+           << " * " << p.get_string() << "\n"
+           << " *\n"
+           << " * This file is generated by dcmt64-codegen.\n"
+           << " */\n"
+           << "#include <stdint.h>\n"
+           << "#include <stddef.h>\n"
+           << "\n"
+           << "class " << opt.name << " {\n"
+           << "public:\n"
+           << "    enum {mexp = " << dec << p.mexp << ", id = " << p.id
+           << ", size = " << size << ", pos = " << p.pos << "};\n"
+           << "    static constexpr uint64_t mat = " << hex64(p.mat) << ";\n"
+           << "    static constexpr uint64_t tmsk1 = " << hex64(p.tmsk1)
+           << ";\n"
+           << "    static constexpr uint64_t tmsk2 = " << hex64(p.tmsk2)
+           << ";\n"
+           << "\n"
+           << "    explicit " << opt.name << "(uint64_t seed = 1) {\n"
+           << "        this->seed(seed);\n"
+           << "    }\n"
+           << "\n"
+           << "    /**\n"
+           << "     * same as mt64::seed()\n"
+           << "     */\n"
+           << "    void seed(uint64_t seed) {\n"
+           << "        state[0] = seed;\n"
+           << "        for (int i = 1; i < size; i++) {\n"
+           << "            state[i] = UINT64_C(6364136223846793005)\n"
+           << "                * (state[i - 1] ^ (state[i - 1] >> 62)) + i;\n"
+           << "        }\n"
+           << "        index = size;\n"
+           << "    }\n"
+           << "\n"
+           << "    uint64_t next() {\n"
+           << "        if (index >= size) {\n"
+           << "            refill(output);\n"
+           << "            index = 0;\n"
+           << "        }\n"
+           << "        return output[index++];\n"
+           << "    }\n"
+           << "\n"
+           << "    /**\n"
+           << "     * generate num outputs. whole blocks are written to array\n"
+           << "     * directly.\n"
+           << "     */\n"
+           << "    void fill(uint64_t array[], size_t num) {\n"
+           << "        size_t i = 0;\n"
+           << "        while (i < num && index < size) {\n"
+           << "            array[i++] = output[index++];\n"
+           << "        }\n"
+           << "        while (num - i >= static_cast<size_t>(size)) {\n"
+           << "            refill(&array[i]);\n"
+           << "            i += size;\n"
+           << "        }\n"
+           << "        while (i < num) {\n"
+           << "            array[i++] = next();\n"
+           << "        }\n"
+           << "    }\n"
+           << "private:\n"
+           << "    static constexpr uint64_t lower_mask = "
+           << hex64(lower_mask) << ";\n"
+           << "    static constexpr uint64_t upper_mask = "
+           << hex64(~lower_mask) << ";\n"
+           << "    uint64_t state[size];\n"
+           << "    uint64_t output[size];\n"
+           << "    int index;\n"
+           << "\n"
+           << "    static uint64_t twist(uint64_t a, uint64_t b) {\n"
+           << "        uint64_t x = (a & upper_mask) | (b & lower_mask);\n"
+           << "        return (x >> 1) ^ ((0 - (x & 1)) & mat);\n"
+           << "    }\n"
+           << "\n"
+           << "    static uint64_t temper(uint64_t y) {\n"
+           << "        y ^= (y >> 29) & UINT64_C(0x5555555555555555);\n"
+           << "        y ^= (y << 17) & tmsk1;\n"
+           << "        y ^= (y << 37) & tmsk2;\n"
+           << "        y ^= y >> 43;\n"
+           << "        return y;\n"
+           << "    }\n"
+           << "\n"
+           << "    /**\n"
+           << "     * advance state by size steps and write tempered outputs.\n"
+           << "     */\n"
+           << "    void refill(uint64_t out[]) {\n"
+           << "        uint64_t * st = state;\n";
+        // i + pos < size
+        output_loop(os, opt.unroll, 0, size - p.pos, p.pos, 1);
+        // i + pos >= size
+        output_loop(os, opt.unroll, size - p.pos, size - 1, p.pos - size, 1);
+        os << "        st[" << dec << (size - 1) << "] = st[" << (p.pos - 1)
+           << "] ^ twist(st[" << (size - 1) << "], st[0]);\n"
+           << "        for (int i = 0; i < size; i++) {\n"
+           << "            out[i] = temper(st[i]);\n"
+           << "        }\n"
+           << "    }\n"
+           << "};\n"
+           << "\n"
+           << "#endif // " << guard << "\n";
+    }
+
+    /**
+     * output st[i] = st[i + offset] ^ twist(st[i], st[i + next])
+     * for start <= i < end, unrolled.
+     */
+    void output_loop(ostream& os, int unroll, int start, int end,
+                     int offset, int next) {
+        int len = end - start;
+        if (len <= 0) {
+            return;
+        }
+        int blocks = len / unroll;
+        int rest = start + blocks * unroll;
+        if (blocks > 0) {
+            os << "        for (int i = " << dec << start << "; i < " << rest
+               << "; i += " << unroll << ") {\n";
+            for (int u = 0; u < unroll; u++) {
+                os << "            st[" << index_expr(u) << "] = st["
+                   << index_expr(u + offset) << "] ^ twist(st["
+                   << index_expr(u) << "], st[" << index_expr(u + next)
+                   << "]);\n";
+            }
+            os << "        }\n";
+        }
+        for (int i = rest; i < end; i++) {
+            os << "        st[" << dec << i << "] = st[" << (i + offset)
+               << "] ^ twist(st[" << i << "], st[" << (i + next) << "]);\n";
+        }
+    }
+
+    /**
+     * command line option parser
+     * @param opt a structure to keep the result of parsing
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     * @return command line options have error, or not
+     */
+    bool parse_opt(options& opt, int argc, char **argv) {
+        opt.unroll = 4;
+        opt.name = "";
+        opt.outfilename = "";
+        int c;
+        bool error = false;
+        string pgm = argv[0];
+        static struct option longopts[] = {
+            {"name", required_argument, NULL, 'n'},
+            {"file", required_argument, NULL, 'f'},
+            {"unroll", required_argument, NULL, 'u'},
+            {NULL, 0, NULL, 0}};
+        errno = 0;
+        for (;;) {
+            c = getopt_long(argc, argv, "n:f:u:", longopts, NULL);
+            if (error) {
+                break;
+            }
+            if (c == -1) {
+                break;
+            }
+            switch (c) {
+            case 'n':
+                opt.name = optarg;
+                break;
+            case 'f':
+                opt.outfilename = optarg;
+                break;
+            case 'u':
+                opt.unroll = strtol(optarg, NULL, 10);
+                if (errno || opt.unroll <= 0) {
+                    error = true;
+                    cerr << "unroll must be a positive number" << endl;
+                }
+                break;
+            case '?':
+            default:
+                error = true;
+                break;
+            }
+        }
+        argc -= optind;
+        argv += optind;
+        if (argc != 1) {
+            error = true;
+        } else if (!opt.param.parse(argv[0])) {
+            cerr << "wrong parameter:" << argv[0] << endl;
+            error = true;
+        }
+        if (!error && opt.name.empty()) {
+            ostringstream ss;
+            ss << "mt64_" << dec << opt.param.mexp << "_" << opt.param.id;
+            opt.name = ss.str();
+        }
+        for (size_t i = 0; !error && i < opt.name.size(); i++) {
+            char ch = opt.name[i];
+            if (!isalnum(ch) && ch != '_') {
+                cerr << "name must be an identifier" << endl;
+                error = true;
+            }
+        }
+        if (error) {
+            output_help(pgm);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * showing help message
+     * @param pgm program name
+     */
+    void output_help(string& pgm)
+    {
+        cerr << "usage:" << endl;
+        cerr << pgm
+             << " [-n name] [-f file] [-u unroll] mexp,id,pos,mat,tmsk1,tmsk2"
+             << endl;
+        static string help_string1 = "\n"
+            "--name, -n name      class name of the generator. default is\n"
+            "                     mt64_<mexp>_<id>.\n"
+            "--file, -f file      the header is outputted to this file. without\n"
+            "                     this option, it is outputted to standard output.\n"
+            "--unroll, -u num     unroll count of the block refill. default is 4.\n"
+            ;
+        cerr << help_string1 << endl;
+    }
+}
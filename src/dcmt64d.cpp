@@ -0,0 +1,615 @@
+/**
+ * @file dcmt64d.cpp
+ *
+ * @brief local parameter server of 64 bit Mersenne Twister.
+ *
+ * dcmt64d answers requests of parameters over a Unix domain socket.
+ * A request is a line "mexp,id" and the answer is a line of
+ * parameters, which is the same as the output of dcmt64, or a line
+ * starts with "error:". A line "stats" returns counters of the
+ * server. A connection can send many requests.
+ *
+ * Parameters given by files are kept in an in-memory index. If a
+ * requested parameter is not in the index, it is searched by a
+ * thread pool, and requests of the same parameter which come during
+ * the search wait for the same search.
+ *
+ * Each connection is served by its own thread, and the number of
+ * connections served at once is limited. SIGINT and SIGTERM are
+ * blocked in all threads and received by sigwait in one thread,
+ * which stops the server.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include "mt64Search.hpp"
+#include "ThreadPool.hpp"
+#include "search.h"
+#include "options.h"
+
+using namespace std;
+using namespace MTToolBox;
+
+class server_options {
+public:
+    bool verbose;
+    int threads;
+    int max_connections;
+    uint64_t seed;
+    string socket_path;
+    string store;
+    vector<string> files;
+};
+
+namespace {
+    typedef pair<int, uint32_t> param_key;
+
+    /**
+     * @class param_server
+     * @brief index of parameters and searches of missing parameters.
+     */
+    class param_server {
+    public:
+        param_server(const server_options& sopt) :
+            sopt(sopt), pool(sopt.threads) {
+            hits = 0;
+            misses = 0;
+            coalesced = 0;
+        }
+
+        /**
+         * add parameters to the index.
+         * @param params parameters
+         * @param lines parameter lines, which may have delta
+         */
+        void add(const vector<mt64_param>& params,
+                 const vector<string>& lines) {
+            unique_lock<mutex> lock(mtx);
+            for (size_t i = 0; i < params.size(); i++) {
+                index[param_key(params[i].mexp, params[i].id)] = lines[i];
+            }
+        }
+
+        /**
+         * answer a request line.
+         * @param request "mexp,id" or "stats"
+         * @return answer line without newline
+         */
+        string answer(const string& request) {
+            if (request == "stats") {
+                return stats();
+            }
+            int mexp;
+            int64_t id;
+            if (!parse_request(request, mexp, id)) {
+                return "error: request must be mexp,id";
+            }
+            if (!is_allowed_mexp(mexp)) {
+                return "error: unsupported mexp";
+            }
+            if (id < 0 || id >= INT64_C(0x100000000)) {
+                return "error: id must be 0 <= id < 2^32-1";
+            }
+            param_key key(mexp, static_cast<uint32_t>(id));
+            shared_future<string> result;
+            {
+                unique_lock<mutex> lock(mtx);
+                map<param_key, string>::iterator it = index.find(key);
+                if (it != index.end()) {
+                    hits++;
+                    return it->second;
+                }
+                map<param_key, shared_future<string> >::iterator
+                    ft = inflight.find(key);
+                if (ft != inflight.end()) {
+                    coalesced++;
+                    result = ft->second;
+                } else {
+                    misses++;
+                    shared_ptr<promise<string> > p(new promise<string>());
+                    result = p->get_future().share();
+                    inflight[key] = result;
+                    pool.submit([this, key, p]() {
+                            p->set_value(search_param(key));
+                        });
+                }
+            }
+            return result.get();
+        }
+    private:
+        const server_options& sopt;
+        ThreadPool pool;
+        mutex mtx;
+        map<param_key, string> index;
+        map<param_key, shared_future<string> > inflight;
+        long hits;
+        long misses;
+        long coalesced;
+
+        string stats() {
+            unique_lock<mutex> lock(mtx);
+            ostringstream ss;
+            ss << "entries=" << dec << index.size()
+               << ",hits=" << hits
+               << ",misses=" << misses
+               << ",coalesced=" << coalesced
+               << ",searching=" << inflight.size();
+            return ss.str();
+        }
+
+        /**
+         * search a parameter by a worker thread of the pool.
+         * @return parameter line, or error line
+         */
+        string search_param(const param_key& key) {
+            options opt;
+            init_opt(opt);
+            opt.mexp = key.first;
+            opt.id = key.second;
+            opt.seed = sopt.seed;
+            opt.threads = 1;
+            opt.logcount = opt.mexp / 2;
+            opt.max_defect = opt.mexp * 64;
+            ostringstream os;
+            ostringstream log;
+            string line;
+            try {
+                search(opt, os, log, 1, false);
+                istringstream is(os.str());
+                while (getline(is, line)) {
+                    if (!line.empty() && line[0] != '#') {
+                        break;
+                    }
+                    line.clear();
+                }
+            } catch (exception& e) {
+                line = string("error: ") + e.what();
+            }
+            if (line.empty()) {
+                line = "error: parameter not found";
+            }
+            unique_lock<mutex> lock(mtx);
+            if (line.compare(0, 6, "error:") != 0) {
+                index[key] = line;
+                if (!sopt.store.empty()) {
+                    ofstream ofs(sopt.store.c_str(), ios::app);
+                    ofs << line << endl;
+                }
+            }
+            inflight.erase(key);
+            if (sopt.verbose) {
+                time_t t = time(NULL);
+                cerr << "# searched: " << dec << key.first << ","
+                     << key.second << " at " << ctime(&t);
+            }
+            return line;
+        }
+
+        static bool parse_request(const string& request, int& mexp,
+                                  int64_t& id) {
+            const char * p = request.c_str();
+            char * q;
+            errno = 0;
+            mexp = strtol(p, &q, 10);
+            if (errno || q == p || (*q != ',' && *q != ' ')) {
+                return false;
+            }
+            p = q + 1;
+            id = strtoll(p, &q, 0);
+            if (errno || q == p) {
+                return false;
+            }
+            while (*q == ' ' || *q == '\r') {
+                q++;
+            }
+            return *q == '\0';
+        }
+    };
+
+    /**
+     * @class connection_limit
+     * @brief number of connections served at once.
+     */
+    class connection_limit {
+    public:
+        explicit connection_limit(int max) : max(max) {
+            active = 0;
+            stopped = false;
+        }
+
+        /**
+         * wait until a connection can be served.
+         * @return false if the server is stopped
+         */
+        bool acquire() {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [this]() {
+                    return stopped || active < max;
+                });
+            if (stopped) {
+                return false;
+            }
+            active++;
+            return true;
+        }
+
+        void release() {
+            {
+                unique_lock<mutex> lock(mtx);
+                active--;
+            }
+            cv.notify_all();
+        }
+
+        void stop() {
+            {
+                unique_lock<mutex> lock(mtx);
+                stopped = true;
+            }
+            cv.notify_all();
+        }
+    private:
+        int max;
+        int active;
+        bool stopped;
+        mutex mtx;
+        condition_variable cv;
+    };
+
+    bool parse_opt(server_options& opt, int argc, char **argv);
+    void output_help(string& pgm);
+    bool read_param_file(param_server& server, const string& filename,
+                         long& num);
+    void serve(param_server& server, int fd);
+    bool write_all(int fd, const string& str);
+}
+
+int main(int argc, char * argv[])
+{
+    server_options opt;
+    if (!parse_opt(opt, argc, argv)) {
+        return -1;
+    }
+    // block signals before any thread is created, so that all threads
+    // inherit the mask and only the signal thread receives them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    param_server server(opt);
+    long num = 0;
+    for (size_t i = 0; i < opt.files.size(); i++) {
+        if (!read_param_file(server, opt.files[i], num)) {
+            return -1;
+        }
+    }
+    if (!opt.store.empty()) {
+        ifstream ifs(opt.store.c_str());
+        if (ifs && !read_param_file(server, opt.store, num)) {
+            return -1;
+        }
+    }
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        cerr << "can't create socket:" << strerror(errno) << endl;
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (opt.socket_path.size() >= sizeof(addr.sun_path)) {
+        cerr << "socket path is too long:" << opt.socket_path << endl;
+        return -1;
+    }
+    strcpy(addr.sun_path, opt.socket_path.c_str());
+    unlink(opt.socket_path.c_str());
+    if (bind(sock, reinterpret_cast<struct sockaddr *>(&addr),
+             sizeof(addr)) < 0
+        || listen(sock, SOMAXCONN) < 0) {
+        cerr << "can't listen socket:" << opt.socket_path << ":"
+             << strerror(errno) << endl;
+        close(sock);
+        return -1;
+    }
+    int wake[2];
+    if (pipe(wake) < 0) {
+        cerr << "can't create pipe:" << strerror(errno) << endl;
+        close(sock);
+        return -1;
+    }
+    connection_limit connections(opt.max_connections);
+    thread signal_thread([&signals, &connections, &wake]() {
+            int sig;
+            while (sigwait(&signals, &sig) != 0) {
+            }
+            connections.stop();
+            ssize_t n = write(wake[1], "", 1);
+            (void)n;
+        });
+    signal_thread.detach();
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        cerr << "# dcmt64d start " << opt.socket_path
+             << " parameters = " << dec << num << " at " << ctime(&t);
+    }
+    while (connections.acquire()) {
+        struct pollfd fds[2];
+        fds[0].fd = sock;
+        fds[0].events = POLLIN;
+        fds[1].fd = wake[0];
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0) {
+            connections.release();
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "poll error:" << strerror(errno) << endl;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        int fd = accept(sock, NULL, NULL);
+        if (fd < 0) {
+            connections.release();
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "accept error:" << strerror(errno) << endl;
+            break;
+        }
+        thread th([&server, &connections, fd]() {
+                serve(server, fd);
+                connections.release();
+            });
+        th.detach();
+    }
+    close(sock);
+    unlink(opt.socket_path.c_str());
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        cerr << "# dcmt64d end at " << ctime(&t);
+    }
+    // searches in progress are abandoned.
+    exit(0);
+}
+
+namespace {
+    /**
+     * answer requests of one connection.
+     */
+    void serve(param_server& server, int fd) {
+        string buffer;
+        char buf[4096];
+        for (;;) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            buffer.append(buf, n);
+            size_t start = 0;
+            size_t end;
+            bool ok = true;
+            while ((end = buffer.find('\n', start)) != string::npos) {
+                string answer = server.answer(buffer.substr(start,
+                                                            end - start));
+                answer += '\n';
+                if (!write_all(fd, answer)) {
+                    ok = false;
+                    break;
+                }
+                start = end + 1;
+            }
+            if (!ok) {
+                break;
+            }
+            buffer.erase(0, start);
+        }
+        close(fd);
+    }
+
+    bool write_all(int fd, const string& str) {
+        const char * p = str.c_str();
+        size_t len = str.size();
+        while (len > 0) {
+            ssize_t n = write(fd, p, len);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    /**
+     * read parameter lines from file into the index.
+     * @param server parameters are added to its index
+     * @param filename file name
+     * @param num number of parameters read is added
+     * @return false if file can't be read
+     */
+    bool read_param_file(param_server& server, const string& filename,
+                         long& num) {
+        ifstream ifs(filename.c_str());
+        if (!ifs) {
+            cerr << "can't open file:" << filename << endl;
+            return false;
+        }
+        vector<mt64_param> params;
+        vector<string> lines;
+        string line;
+        while (getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            mt64_param param;
+            if (!param.parse(line)) {
+                cerr << "wrong parameter:" << line << endl;
+                return false;
+            }
+            params.push_back(param);
+            lines.push_back(line);
+        }
+        server.add(params, lines);
+        num += params.size();
+        return true;
+    }
+
+    /**
+     * command line option parser
+     * @param opt a structure to keep the result of parsing
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     * @return command line options have error, or not
+     */
+    bool parse_opt(server_options& opt, int argc, char **argv) {
+        opt.verbose = false;
+        opt.threads = 0;
+        opt.max_connections = 64;
+        opt.seed = 1;
+        opt.socket_path = "/tmp/dcmt64d.sock";
+        opt.store = "";
+        int c;
+        bool error = false;
+        string pgm = argv[0];
+        static struct option longopts[] = {
+            {"verbose", no_argument, NULL, 'v'},
+            {"socket", required_argument, NULL, 'u'},
+            {"file", required_argument, NULL, 'f'},
+            {"store", required_argument, NULL, 'o'},
+            {"threads", required_argument, NULL, 't'},
+            {"max-connections", required_argument, NULL, 'c'},
+            {"seed", required_argument, NULL, 's'},
+            {NULL, 0, NULL, 0}};
+        errno = 0;
+        for (;;) {
+            c = getopt_long(argc, argv, "vu:f:o:t:c:s:", longopts, NULL);
+            if (error) {
+                break;
+            }
+            if (c == -1) {
+                break;
+            }
+            switch (c) {
+            case 'u':
+                opt.socket_path = optarg;
+                break;
+            case 'f':
+                opt.files.push_back(optarg);
+                break;
+            case 'o':
+                opt.store = optarg;
+                break;
+            case 't':
+                opt.threads = strtol(optarg, NULL, 10);
+                if (errno || opt.threads < 0) {
+                    error = true;
+                    cerr << "threads must be a non negative number" << endl;
+                }
+                break;
+            case 'c':
+                opt.max_connections = strtol(optarg, NULL, 10);
+                if (errno || opt.max_connections <= 0) {
+                    error = true;
+                    cerr << "max-connections must be a positive number"
+                         << endl;
+                }
+                break;
+            case 's':
+                opt.seed = strtoull(optarg, NULL, 0);
+                if (errno) {
+                    error = true;
+                    cerr << "seed must be a number" << endl;
+                }
+                break;
+            case 'v':
+                opt.verbose = true;
+                break;
+            case '?':
+            default:
+                error = true;
+                break;
+            }
+        }
+        if (error) {
+            output_help(pgm);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * showing help message
+     * @param pgm program name
+     */
+    void output_help(string& pgm)
+    {
+        cerr << "usage:" << endl;
+        cerr << pgm
+             << " [-v] [-u socket] [-f file ...] [-o store] [-t threads]"
+             << " [-c max] [-s seed]"
+             << endl;
+        static string help_string1 = "\n"
+            "--verbose, -v        Verbose mode. Output searches to stderr.\n"
+            "--socket, -u path    path of Unix domain socket. default is\n"
+            "                     /tmp/dcmt64d.sock.\n"
+            "--file, -f file      read known parameters from file, which is the\n"
+            "                     output of dcmt64. can be given many times.\n"
+            "--store, -o file     read parameters from file at start, and append\n"
+            "                     searched parameters to it.\n"
+            "--threads, -t num    number of search threads. default is number\n"
+            "                     of hardware threads.\n"
+            "--max-connections, -c max\n"
+            "                     number of connections served at once, more\n"
+            "                     connections wait in the listen queue. default\n"
+            "                     is 64.\n"
+            "--seed, -s seed      seed of searches.\n"
+            "\n"
+            "A request is a line \"mexp,id\", and the answer is a line of\n"
+            "parameters, or a line starts with \"error:\". A line \"stats\"\n"
+            "returns counters of the server.\n"
+            ;
+        cerr << help_string1 << endl;
+    }
+}
@@ -0,0 +1,321 @@
+/**
+ * @file dcmt64d_bench.cpp
+ *
+ * @brief load generator of dcmt64d, which measures latency of
+ * requests.
+ *
+ * Client threads connect to dcmt64d and send requests of parameters
+ * whose ids are chosen at random from the given range, one by one,
+ * and the latency of each request is measured. Percentiles of
+ * latency and throughput are outputted.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <random>
+#include "deadline.hpp"
+
+using namespace std;
+
+class options {
+public:
+    string socket_path;
+    int clients;
+    int requests;
+    int mexp;
+    int64_t first_id;
+    int64_t last_id;
+    uint64_t seed;
+};
+
+namespace {
+    struct client_result {
+        vector<double> latency;
+        long errors;
+    };
+
+    bool parse_opt(options& opt, int argc, char **argv);
+    void output_help(string& pgm);
+    void client(const options& opt, int num, client_result& result);
+    int connect_server(const string& path);
+    bool request(int fd, const string& req, string& answer);
+    double percentile(const vector<double>& sorted, double p);
+}
+
+int main(int argc, char * argv[])
+{
+    options opt;
+    if (!parse_opt(opt, argc, argv)) {
+        return -1;
+    }
+    vector<client_result> results(opt.clients);
+    vector<thread> threads;
+    double start = Deadline::now();
+    for (int i = 0; i < opt.clients; i++) {
+        threads.push_back(thread(client, cref(opt), i, ref(results[i])));
+    }
+    for (int i = 0; i < opt.clients; i++) {
+        threads[i].join();
+    }
+    double elapsed = Deadline::now() - start;
+    vector<double> all;
+    long errors = 0;
+    for (int i = 0; i < opt.clients; i++) {
+        all.insert(all.end(), results[i].latency.begin(),
+                   results[i].latency.end());
+        errors += results[i].errors;
+    }
+    if (all.empty()) {
+        cerr << "no answer from " << opt.socket_path << endl;
+        return -1;
+    }
+    sort(all.begin(), all.end());
+    cout << "# clients = " << dec << opt.clients
+         << ", requests = " << all.size()
+         << ", errors = " << errors << endl;
+    cout << fixed << setprecision(3);
+    cout << "# throughput = " << (all.size() / elapsed) << " req/sec"
+         << endl;
+    cout << "# latency msec: min = " << (all.front() * 1000)
+         << ", p50 = " << (percentile(all, 0.50) * 1000)
+         << ", p90 = " << (percentile(all, 0.90) * 1000)
+         << ", p99 = " << (percentile(all, 0.99) * 1000)
+         << ", max = " << (all.back() * 1000) << endl;
+    if (errors > 0) {
+        return -1;
+    }
+    return 0;
+}
+
+namespace {
+    /**
+     * one client, which sends opt.requests requests through one
+     * connection.
+     */
+    void client(const options& opt, int num, client_result& result) {
+        result.errors = 0;
+        int fd = connect_server(opt.socket_path);
+        if (fd < 0) {
+            result.errors = opt.requests;
+            return;
+        }
+        mt19937_64 mt(opt.seed + num);
+        uniform_int_distribution<int64_t> dist(opt.first_id, opt.last_id);
+        for (int i = 0; i < opt.requests; i++) {
+            ostringstream ss;
+            ss << dec << opt.mexp << "," << dist(mt);
+            string answer;
+            double start = Deadline::now();
+            if (!request(fd, ss.str(), answer)) {
+                result.errors += opt.requests - i;
+                break;
+            }
+            result.latency.push_back(Deadline::now() - start);
+            if (answer.compare(0, 6, "error:") == 0) {
+                result.errors++;
+            }
+        }
+        close(fd);
+    }
+
+    int connect_server(const string& path) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                    sizeof(addr)) < 0) {
+            cerr << "can't connect:" << path << ":" << strerror(errno)
+                 << endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * send a request line and receive an answer line.
+     */
+    bool request(int fd, const string& req, string& answer) {
+        string line = req + "\n";
+        const char * p = line.c_str();
+        size_t len = line.size();
+        while (len > 0) {
+            ssize_t n = write(fd, p, len);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        answer.clear();
+        char c;
+        for (;;) {
+            ssize_t n = read(fd, &c, 1);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            if (c == '\n') {
+                return true;
+            }
+            answer += c;
+        }
+    }
+
+    double percentile(const vector<double>& sorted, double p) {
+        size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[i];
+    }
+
+    /**
+     * command line option parser
+     * @param opt a structure to keep the result of parsing
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     * @return command line options have error, or not
+     */
+    bool parse_opt(options& opt, int argc, char **argv) {
+        opt.socket_path = "/tmp/dcmt64d.sock";
+        opt.clients = 8;
+        opt.requests = 1000;
+        opt.mexp = 521;
+        opt.first_id = 0;
+        opt.last_id = 99;
+        opt.seed = 1;
+        int c;
+        bool error = false;
+        string pgm = argv[0];
+        static struct option longopts[] = {
+            {"socket", required_argument, NULL, 'u'},
+            {"clients", required_argument, NULL, 'n'},
+            {"requests", required_argument, NULL, 'r'},
+            {"mexp", required_argument, NULL, 'm'},
+            {"id-range", required_argument, NULL, 'R'},
+            {"seed", required_argument, NULL, 's'},
+            {NULL, 0, NULL, 0}};
+        errno = 0;
+        for (;;) {
+            c = getopt_long(argc, argv, "u:n:r:m:R:s:", longopts, NULL);
+            if (error) {
+                break;
+            }
+            if (c == -1) {
+                break;
+            }
+            char * p;
+            switch (c) {
+            case 'u':
+                opt.socket_path = optarg;
+                break;
+            case 'n':
+                opt.clients = strtol(optarg, NULL, 10);
+                if (errno || opt.clients <= 0) {
+                    error = true;
+                    cerr << "clients must be a positive number" << endl;
+                }
+                break;
+            case 'r':
+                opt.requests = strtol(optarg, NULL, 10);
+                if (errno || opt.requests <= 0) {
+                    error = true;
+                    cerr << "requests must be a positive number" << endl;
+                }
+                break;
+            case 'm':
+                opt.mexp = strtol(optarg, NULL, 10);
+                if (errno) {
+                    error = true;
+                    cerr << "mexp must be a number" << endl;
+                }
+                break;
+            case 'R':
+                opt.first_id = strtoll(optarg, &p, 0);
+                if (errno || *p != ':') {
+                    error = true;
+                    cerr << "id-range must be START:END" << endl;
+                    break;
+                }
+                opt.last_id = strtoll(p + 1, &p, 0);
+                if (errno || *p != '\0' || opt.last_id < opt.first_id) {
+                    error = true;
+                    cerr << "id-range must be START:END" << endl;
+                }
+                break;
+            case 's':
+                opt.seed = strtoull(optarg, NULL, 0);
+                if (errno) {
+                    error = true;
+                    cerr << "seed must be a number" << endl;
+                }
+                break;
+            case '?':
+            default:
+                error = true;
+                break;
+            }
+        }
+        if (error) {
+            output_help(pgm);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * showing help message
+     * @param pgm program name
+     */
+    void output_help(string& pgm)
+    {
+        cerr << "usage:" << endl;
+        cerr << pgm
+             << " [-u socket] [-n clients] [-r requests] [-m mexp]"
+             << " [-R start:end] [-s seed]"
+             << endl;
+        static string help_string1 = "\n"
+            "--socket, -u path    path of Unix domain socket of dcmt64d.\n"
+            "--clients, -n num    number of concurrent clients. default is 8.\n"
+            "--requests, -r num   number of requests of each client.\n"
+            "                     default is 1000.\n"
+            "--mexp, -m mexp      mersenne exponent of requests. default is 521.\n"
+            "--id-range, -R s:e   ids of requests are chosen from s to e at\n"
+            "                     random. default is 0:99.\n"
+            "--seed, -s seed      seed of choice of ids.\n"
+            ;
+        cerr << help_string1 << endl;
+    }
+}
@@ -21,12 +21,17 @@
  */
 #include <stdint.h>
 #include <inttypes.h>
+#include <stdio.h>
 #include <time.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <MTToolBox/AlgorithmRecursionSearch.hpp>
 #include <MTToolBox/AlgorithmEquidistribution.hpp>
 #include <MTToolBox/MersenneTwister.hpp>
@@ -34,7 +39,9 @@
 #include <NTL/GF2X.h>
 #include <getopt.h>
 #include "mpicontrol.hpp"
+#include "mpioutput.hpp"
 #include "mt64Search.hpp"
+#include "MemoryBudget.hpp"
 #include "search.h"
 #include "options.h"
 
@@ -42,6 +49,14 @@ using namespace std;
 using namespace MTToolBox;
 using namespace NTL;
 
+namespace {
+    // number of ranks whose outputs are gathered to one aggregator
+    const int RANKS_PER_AGGREGATOR = 32;
+
+    int shared_output_search(MPIControl& mpi, options& opt,
+                             search_func func, bool idle);
+}
+
 /**
  * parse command line option, and search parameters
  * @param argc number of arguments
@@ -55,9 +70,44 @@ int main(int argc, char** argv) {
     if (!parse) {
         return -1;
     }
+    // parse_opt allows these modes without mexp, but they are not
+    // split among ranks.
+    if (!opt.retemper_file.empty() || !opt.campaign_file.empty()) {
+        if (mpi.getRank() == 0) {
+            cerr << "dcmt64mpi does not support --retemper and --campaign,"
+                 << " use dcmt64." << endl;
+        }
+        return -1;
+    }
     // MPI
     char buff[200];
-    opt.id = opt.id + mpi.getRank();
+    bool shared = opt.flush_interval > 0;
+    bool idle = false;
+    if (opt.last_id >= 0) {
+        // hybrid: ids of the range are split into blocks of ranks,
+        // and ids of a block are searched by threads of the rank.
+        if (!mpi.isFunneled()) {
+            if (mpi.getRank() == 0) {
+                cerr << "MPI library does not support threads,"
+                     << " threads = 1 is used." << endl;
+            }
+            opt.threads = 1;
+        }
+        int64_t total = opt.last_id - opt.id + 1;
+        int64_t rank = mpi.getRank();
+        int64_t q = total / mpi.getNumP();
+        int64_t r = total % mpi.getNumP();
+        int64_t first = opt.id + rank * q + (rank < r ? rank : r);
+        opt.last_id = first + q - 1 + (rank < r ? 1 : 0);
+        opt.id = first;
+        // more ranks than ids
+        idle = opt.last_id < opt.id;
+        if (idle && !shared) {
+            return 0;
+        }
+    } else {
+        opt.id = opt.id + mpi.getRank();
+    }
     //if (opt.mexp == 19937) {
     //    opt.fixedPOS = 156;
     //    opt.max_defect = 8000; // mt19937-64 is 7820
@@ -65,6 +115,18 @@ int main(int argc, char** argv) {
     //opt.seq; count down, -1 means uint32_t max
     //opt.count;
     //opt.logcount;
+    // limit of each rank, shared by its threads
+    MemoryBudget budget(opt.memory_limit);
+    if (opt.memory_limit > 0) {
+        opt.memory = &budget;
+    }
+    search_func func = search;
+    if (opt.algorithm == "best") {
+        func = best_search;
+    }
+    if (shared) {
+        return shared_output_search(mpi, opt, func, idle);
+    }
     if (!opt.outfilename.empty()) {
         sprintf(buff, ".s%04ld-%03d.txt", opt.seed, mpi.getRank());
         opt.outfilename += buff;
@@ -98,6 +160,154 @@ int main(int argc, char** argv) {
     } else {
         ls = os;
     }
-    return search(opt, *os, *ls, opt.count);
-    //return best_search(opt, *os, *ls, opt.count); bug? or too slow?
+    if (opt.last_id >= 0) {
+        return search_range(opt, *os, *ls, opt.count, func);
+    }
+    return func(opt, *os, *ls, opt.count, true);
+}
+
+namespace {
+    /**
+     * search in a thread, while the main thread writes outputs of all
+     * ranks to one parameter file and one log file every
+     * opt.flush_interval seconds. Only rank 0 outputs the header line.
+     * Lines are in the order of rank within each flush, and ranks are
+     * interleaved over flushes. When all ranks end, the whole outputs
+     * are written again in the order of rank, which is the order of
+     * id, and replace the files. If the MPI library does not allow a
+     * thread beside MPI calls, the search runs in the main thread and
+     * the outputs are written once at the end.
+     * @param mpi MPI control
+     * @param opt command line options
+     * @param func search function
+     * @param idle this rank has no id to search
+     * @return 0 if this ends normally
+     */
+    int shared_output_search(MPIControl& mpi, options& opt,
+                             search_func func, bool idle) {
+        if (opt.outfilename.empty()) {
+            if (mpi.getRank() == 0) {
+                cerr << "shared-output needs output file" << endl;
+            }
+            return -1;
+        }
+        bool combined = opt.logfilename.empty();
+        MPISharedOutput out(mpi, RANKS_PER_AGGREGATOR);
+        if (!out.open(0, opt.outfilename)
+            || (!combined && !out.open(1, opt.logfilename))) {
+            if (mpi.getRank() == 0) {
+                cerr << "can't open file:" << opt.outfilename << endl;
+            }
+            return -1;
+        }
+        line_buffer param_buf;
+        line_buffer log_buf;
+        ostream os(&param_buf);
+        ostream log(&log_buf);
+        ostream& ls = combined ? os : log;
+        bool header = mpi.getRank() == 0;
+        mutex mtx;
+        condition_variable cv;
+        bool finished = false;
+        int rc = 0;
+        auto run = [&]() {
+            int r = 0;
+            try {
+                if (idle) {
+                    r = 0;
+                } else if (opt.last_id >= 0) {
+                    r = search_range(opt, os, ls, opt.count, func,
+                                     header);
+                } else {
+                    r = func(opt, os, ls, opt.count, header);
+                }
+            } catch (exception& e) {
+                ls << "# search error: " << dec << opt.id << ", "
+                   << e.what() << endl;
+                r = -1;
+            }
+            unique_lock<mutex> lock(mtx);
+            rc = r;
+            finished = true;
+            cv.notify_all();
+        };
+        thread worker;
+        if (mpi.isFunneled()) {
+            worker = thread(run);
+        } else {
+            if (mpi.getRank() == 0) {
+                cerr << "MPI library does not support threads,"
+                     << " outputs are written at the end." << endl;
+            }
+            run();
+        }
+        // all outputs of this rank, for the ordered files
+        string all_params;
+        string all_logs;
+        auto flush = [&](bool all) {
+            string data = all ? param_buf.take_all() : param_buf.take();
+            all_params += data;
+            out.write(0, data);
+            if (!combined) {
+                data = all ? log_buf.take_all() : log_buf.take();
+                all_logs += data;
+                out.write(1, data);
+            }
+        };
+        chrono::duration<double> interval(opt.flush_interval);
+        bool reported = false;
+        for (;;) {
+            int done;
+            {
+                unique_lock<mutex> lock(mtx);
+                // after this rank has finished, wait for others
+                // at the interval
+                cv.wait_for(lock, interval, [&]() {
+                        return finished && !reported;
+                    });
+                done = finished ? 1 : 0;
+            }
+            reported = done != 0;
+            int all_done = 0;
+            MPI_Allreduce(&done, &all_done, 1, MPI_INT, MPI_MIN,
+                          MPI_COMM_WORLD);
+            if (all_done) {
+                flush(true);
+                break;
+            }
+            flush(false);
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        out.close();
+        // ranks search ascending ids, opt.id + rank or blocks of -R,
+        // so the order of rank is the order of id.
+        string sorted_out = opt.outfilename + ".sorted";
+        string sorted_log = opt.logfilename + ".sorted";
+        bool sorted = out.open(0, sorted_out)
+            && (combined || out.open(1, sorted_log));
+        if (sorted) {
+            out.write(0, all_params);
+            if (!combined) {
+                out.write(1, all_logs);
+            }
+        }
+        out.close();
+        if (mpi.getRank() == 0) {
+            bool renamed = sorted
+                && rename(sorted_out.c_str(), opt.outfilename.c_str()) == 0
+                && (combined || rename(sorted_log.c_str(),
+                                       opt.logfilename.c_str()) == 0);
+            if (!renamed) {
+                remove(sorted_out.c_str());
+                if (!combined) {
+                    remove(sorted_log.c_str());
+                }
+                cerr << "can't write sorted files, outputs are not"
+                     << " sorted by id" << endl;
+            }
+        }
+        return rc;
+    }
 }
@@ -0,0 +1,113 @@
+#pragma once
+#ifndef DEADLINE_HPP
+#define DEADLINE_HPP
+/**
+ * @file deadline.hpp
+ *
+ * @brief wall clock deadline of search.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+
+/**
+ * @class time_limit_error
+ * @brief thrown by generators when the deadline has passed.
+ */
+class time_limit_error : public std::runtime_error {
+public:
+    time_limit_error() : std::runtime_error("time limit exceeded") {
+    }
+};
+
+/**
+ * @class Deadline
+ * @brief a flag which becomes true at the deadline.
+ *
+ * A timer thread sets the flag, so that the flag can be checked in
+ * the innermost loop of search without calling clock.
+ */
+class Deadline {
+public:
+    /**
+     * Constructor
+     * @param at deadline in seconds of now(), 0 means no deadline.
+     */
+    explicit Deadline(double at) : expired(false), cancel(false) {
+        if (at <= 0) {
+            return;
+        }
+        if (at <= now()) {
+            expired = true;
+            return;
+        }
+        timer = std::thread(&Deadline::wait, this, at);
+    }
+
+    ~Deadline() {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cancel = true;
+        }
+        cv.notify_all();
+        if (timer.joinable()) {
+            timer.join();
+        }
+    }
+
+    /**
+     * @return pointer to the flag which becomes true at the deadline
+     */
+    const std::atomic<bool> * flag() const {
+        return &expired;
+    }
+
+    bool isExpired() const {
+        return expired.load();
+    }
+
+    /**
+     * @return seconds of monotonic clock
+     */
+    static double now() {
+        using namespace std::chrono;
+        return duration<double>(
+            steady_clock::now().time_since_epoch()).count();
+    }
+private:
+    void wait(double at) {
+        using namespace std::chrono;
+        steady_clock::time_point tp(
+            duration_cast<steady_clock::duration>(duration<double>(at)));
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!cancel) {
+            if (cv.wait_until(lock, tp) == std::cv_status::timeout) {
+                expired = true;
+                break;
+            }
+        }
+    }
+    Deadline(const Deadline&);
+    Deadline& operator=(const Deadline&);
+    std::atomic<bool> expired;
+    bool cancel;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread timer;
+};
+
+#endif // DEADLINE_HPP
@@ -7,13 +7,28 @@
 #define MPI_UNDEFINED -1
 #define MPI_INT 0
 #define MPI_DOUBLE 1
+#define MPI_THREAD_SINGLE 0
+#define MPI_THREAD_FUNNELED 1
+#define MPI_THREAD_SERIALIZED 2
+#define MPI_THREAD_MULTIPLE 3
+#define MPI_SUCCESS 0
+#define MPI_COMM_NULL -1
+#define MPI_CHAR 2
+#define MPI_LONG_LONG 3
+#define MPI_SUM 0
+#define MPI_MIN 1
+#define MPI_MODE_CREATE 1
+#define MPI_MODE_WRONLY 4
+#define MPI_INFO_NULL 0
+#define MPI_STATUS_IGNORE 0
 
 #define MPI_Init(a, b) (void)a, (void)b
+#define MPI_Init_thread(a, b, c, d) (void)a, (void)b, (*(d) = (c))
 #define MPI_Comm_rank(a, b) (void)a, (void)b
 #define MPI_Comm_size(a, b) (void)a, (void)b
 #define MPI_Finalize()
 #define MPI_Abort(a, b) (void)a, (void)b
-#define MPI_Comm_split(a, b, c, d) (void)a, (void)b, (void)c, (void)d
+#define MPI_Comm_split(a, b, c, d) (void)(a), (void)(b), (void)(c), (void)(d)
 #define MPI_Bcast(a, b, c, d, e) (void)a, (void)b, (void)c, (void)d, \
         (void)e
 #define MPI_Send(a, b, c, d, e, f) (void)a, (void)b, (void)c, (void)d, \
@@ -22,8 +37,26 @@
         (void)e, (void)f, (void)g
 #define MPI_Allgather(a, b, c, d, e, f, g) (void)a, (void)b, (void)c, (void)d, \
         (void)e, (void)f, (void)g
+#define MPI_Gather(a, b, c, d, e, f, g, h) (void)(a), (void)(b), \
+        (void)(c), (void)(d), (void)(e), (void)(f), (void)(g), (void)(h)
+#define MPI_Gatherv(a, b, c, d, e, f, g, h, i) (void)(a), (void)(b), \
+        (void)(c), (void)(d), (void)(e), (void)(f), (void)(g), (void)(h), \
+        (void)(i)
+#define MPI_Exscan(a, b, c, d, e, f) (void)(a), (void)(b), (void)(c), \
+        (void)(d), (void)(e), (void)(f)
+#define MPI_Allreduce(a, b, c, d, e, f) (void)(a), (void)(b), (void)(c), \
+        (void)(d), (void)(e), (void)(f)
+#define MPI_File_open(a, b, c, d, e) ((void)(a), (void)(b), (void)(c), \
+        (void)(d), (void)(e), MPI_SUCCESS)
+#define MPI_File_set_size(a, b) (void)(a), (void)(b)
+#define MPI_File_write_at_all(a, b, c, d, e, f) (void)(a), (void)(b), \
+        (void)(c), (void)(d), (void)(e), (void)(f)
+#define MPI_File_sync(a) (void)(a)
+#define MPI_File_close(a) (void)(a)
 #define MPI_Comm_free(a) (void)a
 #define MPI_Comm int
+#define MPI_File int
+#define MPI_Offset long long
 struct MPI_Status {
     int MPI_SOURCE;
 };
@@ -34,10 +67,16 @@ struct MPI_Status {
 
 class MPIControl {
 public:
+    /**
+     * Constructor
+     * Search threads of a rank never call MPI functions, only the
+     * main thread does, so MPI_THREAD_FUNNELED is requested.
+     */
     MPIControl(int *argc, char** argv[]) {
         world_rank = 0;
         world_num_process = 1;
-        MPI_Init(argc, argv);
+        thread_level = MPI_THREAD_SINGLE;
+        MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &thread_level);
         MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
         MPI_Comm_size(MPI_COMM_WORLD, &world_num_process);
     }
@@ -58,9 +97,18 @@ public:
         return world_num_process;
     }
 
+    /**
+     * @return true if threads which do not call MPI functions can run
+     * beside the main thread which calls them
+     */
+    bool isFunneled() {
+        return thread_level >= MPI_THREAD_FUNNELED;
+    }
+
 private:
     int world_rank;
     int world_num_process;
+    int thread_level;
 };
 
 #endif // MPICONTROL_HPP
@@ -0,0 +1,216 @@
+#pragma once
+#ifndef MPIOUTPUT_HPP
+#define MPIOUTPUT_HPP
+/**
+ * @file mpioutput.hpp
+ *
+ * @brief shared output files of all ranks written by MPI-IO.
+ *
+ * Ranks are divided into groups, and the first rank of each group is
+ * an aggregator. In each round, outputs of ranks are gathered to the
+ * aggregator of their group, and the aggregators write them to one
+ * file by a collective write, in the order of rank.
+ *
+ * The order of rank holds only within a round. Each round appends
+ * the lines completed since the previous round, so lines of a rank
+ * are interleaved with lines of other ranks over rounds. The rounds
+ * survive a killed job. To make one ordered file at the end, the
+ * caller keeps all outputs of its rank, writes them again to another
+ * file by one write(), and replaces the file by it.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <string>
+#include <vector>
+#include <mutex>
+#include <streambuf>
+#include "mpicontrol.hpp"
+
+/**
+ * @class line_buffer
+ * @brief stream buffer which keeps outputs of a search thread until
+ * the main thread takes them.
+ */
+class line_buffer : public std::streambuf {
+public:
+    /**
+     * @return complete lines written so far, they are removed from
+     * the buffer.
+     */
+    std::string take() {
+        std::unique_lock<std::mutex> lock(mtx);
+        size_t n = buf.rfind('\n');
+        if (n == std::string::npos) {
+            return std::string();
+        }
+        std::string result = buf.substr(0, n + 1);
+        buf.erase(0, n + 1);
+        return result;
+    }
+
+    /**
+     * @return all outputs including the last incomplete line
+     */
+    std::string take_all() {
+        std::unique_lock<std::mutex> lock(mtx);
+        std::string result;
+        result.swap(buf);
+        return result;
+    }
+protected:
+    int overflow(int c) {
+        if (c != traits_type::eof()) {
+            std::unique_lock<std::mutex> lock(mtx);
+            buf += static_cast<char>(c);
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char * s, std::streamsize n) {
+        std::unique_lock<std::mutex> lock(mtx);
+        buf.append(s, n);
+        return n;
+    }
+private:
+    std::mutex mtx;
+    std::string buf;
+};
+
+/**
+ * @class MPISharedOutput
+ * @brief files shared by all ranks. All methods are collective over
+ * MPI_COMM_WORLD.
+ */
+class MPISharedOutput {
+public:
+    enum {MAX_FILES = 2};
+
+    /**
+     * Constructor
+     * @param mpi MPI control
+     * @param group_size number of ranks of one aggregator
+     */
+    MPISharedOutput(MPIControl& mpi, int group_size) {
+        rank = mpi.getRank();
+        aggregator = rank % group_size == 0;
+        group = MPI_COMM_NULL;
+        aggregators = MPI_COMM_NULL;
+        MPI_Comm_split(MPI_COMM_WORLD, rank / group_size, rank, &group);
+        MPI_Comm_split(MPI_COMM_WORLD, aggregator ? 0 : MPI_UNDEFINED,
+                       rank, &aggregators);
+        for (int i = 0; i < MAX_FILES; i++) {
+            opened[i] = false;
+            base[i] = 0;
+        }
+    }
+
+    ~MPISharedOutput() {
+        close();
+        if (aggregators != MPI_COMM_NULL) {
+            MPI_Comm_free(&aggregators);
+        }
+        if (group != MPI_COMM_NULL) {
+            MPI_Comm_free(&group);
+        }
+    }
+
+    /**
+     * open and truncate a file by aggregators. The next write() writes
+     * at the beginning of the file.
+     * @param file file number, 0 <= file < MAX_FILES
+     * @param name file name
+     * @return true if all aggregators opened the file
+     */
+    bool open(int file, const std::string& name) {
+        int ok = 1;
+        if (aggregator) {
+            int err = MPI_File_open(aggregators,
+                                    const_cast<char *>(name.c_str()),
+                                    MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                    MPI_INFO_NULL, &fh[file]);
+            if (err == MPI_SUCCESS) {
+                MPI_File_set_size(fh[file], 0);
+                opened[file] = true;
+                base[file] = 0;
+            } else {
+                ok = 0;
+            }
+        }
+        int all = 0;
+        MPI_Allreduce(&ok, &all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        return all != 0;
+    }
+
+    /**
+     * write data of all ranks in the order of rank, after the data
+     * of previous calls.
+     * @param file file number
+     * @param data data of this rank
+     */
+    void write(int file, const std::string& data) {
+        int group_num = 1;
+        MPI_Comm_size(group, &group_num);
+        int len = static_cast<int>(data.size());
+        std::vector<int> lens(group_num, 0);
+        MPI_Gather(&len, 1, MPI_INT, &lens[0], 1, MPI_INT, 0, group);
+        std::vector<int> displs(group_num);
+        long long total = 0;
+        for (int i = 0; i < group_num; i++) {
+            displs[i] = static_cast<int>(total);
+            total += lens[i];
+        }
+        std::vector<char> buf(total + 1);
+        MPI_Gatherv(const_cast<char *>(data.data()), len, MPI_CHAR,
+                    &buf[0], &lens[0], &displs[0], MPI_CHAR, 0, group);
+        if (!aggregator) {
+            return;
+        }
+        long long offset = 0;
+        long long sum = 0;
+        MPI_Exscan(&total, &offset, 1, MPI_LONG_LONG, MPI_SUM, aggregators);
+        MPI_Allreduce(&total, &sum, 1, MPI_LONG_LONG, MPI_SUM, aggregators);
+        if (rank == 0) {
+            // result of MPI_Exscan is undefined on the first rank
+            offset = 0;
+        }
+        if (sum == 0) {
+            return;
+        }
+        MPI_File_write_at_all(fh[file], base[file] + offset, &buf[0],
+                              static_cast<int>(total), MPI_CHAR,
+                              MPI_STATUS_IGNORE);
+        // written data survive even if the job is killed after this
+        MPI_File_sync(fh[file]);
+        base[file] += sum;
+    }
+
+    void close() {
+        for (int i = 0; i < MAX_FILES; i++) {
+            if (opened[i]) {
+                MPI_File_close(&fh[i]);
+                opened[i] = false;
+            }
+        }
+    }
+private:
+    int rank;
+    bool aggregator;
+    MPI_Comm group;
+    MPI_Comm aggregators;
+    MPI_File fh[MAX_FILES];
+    bool opened[MAX_FILES];
+    MPI_Offset base[MAX_FILES];
+    MPISharedOutput(const MPISharedOutput&);
+    MPISharedOutput& operator=(const MPISharedOutput&);
+};
+
+#endif // MPIOUTPUT_HPP
@@ -0,0 +1,277 @@
+#pragma once
+#ifndef MT64CHARPOLY_HPP
+#define MT64CHARPOLY_HPP
+/**
+ * @file mt64CharPoly.hpp
+ *
+ * @brief characteristic polynomial of 64 bit Mersenne Twister
+ * calculated from its parameters.
+ *
+ * Let n = size, m = pos, r be the number of lower bits and a_i be
+ * the i-th bit of mat. Then the characteristic polynomial is
+ * \f[
+ * (t^n + t^m)^{w-r} \left( (t^{n-1} + t^{m-1})^r
+ * + \sum_{i=0}^{r-1} a_i (t^{n-1} + t^{m-1})^{r-i-1} \right)
+ * + \sum_{i=r}^{w-1} a_i (t^n + t^m)^{w-i-1},
+ * \f]
+ * see M. Matsumoto and T. Nishimura, Mersenne Twister, ACM TOMACS
+ * 1998. By Horner's rule, it is 64 multiplications by binomials,
+ * which are shifts and xors, so it is much faster than
+ * Berlekamp-Massey on 2 mexp outputs.
+ *
+ * The polynomial can be stored with parameters as a hexadecimal field,
+ * bit i of which is the coefficient of t^i. A stored polynomial is
+ * verified by checking that it annihilates outputs of the generator.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <istream>
+#include <NTL/GF2X.h>
+#include "mt64Search.hpp"
+
+namespace MTToolBox {
+    /**
+     * out = h * (t^a + t^b), polynomials are arrays of words,
+     * bit j of word i is the coefficient of t^{64i+j}.
+     */
+    inline void mt64_mul_binomial(std::vector<uint64_t>& out,
+                                  const std::vector<uint64_t>& h,
+                                  int a, int b) {
+        int len = static_cast<int>(h.size());
+        for (int i = 0; i < len; i++) {
+            out[i] = 0;
+        }
+        const int shifts[] = {a, b};
+        for (int k = 0; k < 2; k++) {
+            int q = shifts[k] / 64;
+            int s = shifts[k] % 64;
+            for (int i = len - 1; i >= q; i--) {
+                uint64_t w = h[i - q] << s;
+                if (s != 0 && i - q - 1 >= 0) {
+                    w |= h[i - q - 1] >> (64 - s);
+                }
+                out[i] ^= w;
+            }
+        }
+    }
+
+    /**
+     * calculate the characteristic polynomial of the state transition
+     * of 64 bit Mersenne Twister.
+     * @param poly the characteristic polynomial, its degree is mexp
+     * @param mexp mersenne exponent
+     * @param pos parameter pos, 1 <= pos < size
+     * @param mat parameter mat
+     */
+    inline void mt64_char_poly(NTL::GF2X& poly, int mexp, int pos,
+                               uint64_t mat) {
+        using namespace NTL;
+        int size = mexp / 64 + 1;
+        int r = 64 - mexp % 64;
+        // degree is mexp, which needs size words
+        int words = size;
+        std::vector<uint64_t> h(words, 0);
+        std::vector<uint64_t> tmp(words, 0);
+        h[0] = 1;
+        for (int i = 0; i < 64; i++) {
+            if (i < r) {
+                mt64_mul_binomial(tmp, h, size - 1, pos - 1);
+            } else {
+                mt64_mul_binomial(tmp, h, size, pos);
+            }
+            tmp[0] ^= (mat >> i) & 1;
+            h.swap(tmp);
+        }
+#if NTL_BITS_PER_LONG == 64
+        poly.xrep.SetLength(words);
+        for (int i = 0; i < words; i++) {
+            poly.xrep[i] = static_cast<_ntl_ulong>(h[i]);
+        }
+        poly.normalize();
+#else
+        clear(poly);
+        for (int i = 0; i <= mexp; i++) {
+            if ((h[i / 64] >> (i % 64)) & 1) {
+                SetCoeff(poly, i);
+            }
+        }
+#endif
+    }
+
+    /**
+     * characteristic polynomial of current parameters of generator,
+     * used by RecursionSearch.
+     * throws time_limit_error if the deadline has passed.
+     * @param poly the characteristic polynomial
+     * @param g generator
+     */
+    inline void char_poly(NTL::GF2X& poly, const mt64& g) {
+        g.checkDeadline();
+        const mt64_param& param = g.getParam();
+        mt64_char_poly(poly, param.mexp, param.pos, param.mat);
+    }
+
+    /**
+     * @param poly polynomial
+     * @return hexadecimal string of poly, the most significant digit
+     * has the coefficient of the highest degree.
+     */
+    inline std::string poly_to_hex(const NTL::GF2X& poly) {
+        using namespace NTL;
+        static const char digits[] = "0123456789abcdef";
+        long d = deg(poly);
+        if (d < 0) {
+            return "0";
+        }
+        std::string hex(d / 4 + 1, '0');
+        for (long i = 0; i <= d; i++) {
+            if (IsOne(coeff(poly, i))) {
+                size_t k = hex.size() - 1 - i / 4;
+                int v = (hex[k] <= '9') ? hex[k] - '0' : hex[k] - 'a' + 10;
+                hex[k] = digits[v | (1 << (i % 4))];
+            }
+        }
+        return hex;
+    }
+
+    /**
+     * read the polynomial stored as the last field of a parameter line.
+     * @param poly polynomial read
+     * @param line parameter line
+     * @param mexp mersenne exponent of the parameter
+     * @return true if the last field is a polynomial of degree mexp,
+     * other fields like delta are never taken as a polynomial.
+     */
+    inline bool parse_poly(NTL::GF2X& poly, const std::string& line,
+                           int mexp) {
+        using namespace NTL;
+        size_t p = line.rfind(',');
+        if (p == std::string::npos) {
+            return false;
+        }
+        size_t end = line.find_last_not_of(" \r");
+        size_t start = line.find_first_not_of(' ', p + 1);
+        if (end == std::string::npos || start == std::string::npos
+            || end < start
+            || end - start + 1 != static_cast<size_t>(mexp / 4 + 1)) {
+            return false;
+        }
+        clear(poly);
+        for (size_t k = start; k <= end; k++) {
+            char c = line[k];
+            int v;
+            if (c >= '0' && c <= '9') {
+                v = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                v = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                v = c - 'A' + 10;
+            } else {
+                clear(poly);
+                return false;
+            }
+            long base = static_cast<long>(end - k) * 4;
+            for (int j = 0; j < 4; j++) {
+                if ((v >> j) & 1) {
+                    SetCoeff(poly, base + j);
+                }
+            }
+        }
+        if (deg(poly) != mexp) {
+            clear(poly);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * read parameter lines and polynomials stored in them.
+     * @param is input stream
+     * @param params parameters read are added to this vector
+     * @param polys polynomials are added to this vector, zero if the
+     * line has no polynomial.
+     * @param bad the first wrong line, if any
+     * @return false if is has a wrong line
+     */
+    inline bool read_params(std::istream& is,
+                            std::vector<mt64_param>& params,
+                            std::vector<NTL::GF2X>& polys,
+                            std::string& bad) {
+        std::string line;
+        while (getline(is, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            mt64_param p;
+            if (!p.parse(line)) {
+                bad = line;
+                return false;
+            }
+            params.push_back(p);
+            polys.push_back(NTL::GF2X());
+            parse_poly(polys.back(), line, p.mexp);
+        }
+        return true;
+    }
+
+    /**
+     * check that poly annihilates outputs of the generator, that is,
+     * sum of c_i x_{j+i} is zero for 0 <= j < 64, where c_i are
+     * coefficients of poly and x_k are outputs. When poly is
+     * irreducible of degree mexp and it is not the characteristic
+     * polynomial, poly(A) is invertible for the state transition A,
+     * so the check fails except for states of negligible probability.
+     * This is much faster than calculating the minimal polynomial.
+     * @param poly polynomial
+     * @param g generator, which is already seeded
+     * @return true if poly annihilates outputs
+     */
+    inline bool annihilates(const NTL::GF2X& poly, mt64& g) {
+        using namespace NTL;
+        const long checks = 64;
+        long d = deg(poly);
+        if (d < 0) {
+            return false;
+        }
+        std::vector<long> terms;
+        for (long i = 0; i <= d; i++) {
+            if (IsOne(coeff(poly, i))) {
+                terms.push_back(i);
+            }
+        }
+        std::vector<uint64_t> out(d + checks);
+        uint64_t any = 0;
+        for (size_t i = 0; i < out.size(); i++) {
+            out[i] = g.generate();
+            any |= out[i];
+        }
+        if (any == 0) {
+            // zero state is annihilated by any polynomial
+            return false;
+        }
+        for (long j = 0; j < checks; j++) {
+            uint64_t x = 0;
+            for (size_t k = 0; k < terms.size(); k++) {
+                x ^= out[j + terms[k]];
+            }
+            if (x != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+#endif // MT64CHARPOLY_HPP
@@ -0,0 +1,523 @@
+#pragma once
+#ifndef MT64RUNTIME_HPP
+#define MT64RUNTIME_HPP
+/**
+ * @file mt64Runtime.hpp
+ *
+ * @brief runtime generators of 64 bit Mersenne Twister using
+ * parameters found by dcmt64.
+ *
+ * This file does not depend on MTToolBox and NTL, and can be copied
+ * to user applications. The generators produce the same sequences
+ * as the class mt64 in mt64Search.hpp.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdexcept>
+#include <vector>
+#include <chrono>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/*
+ * GCC does not vectorize the loops of mt64_block at -O2, and without
+ * -march it can use only SSE2. MT64_VECTORIZE makes versions of a
+ * function for AVX-512, AVX2 and the others with vectorization
+ * enabled, and the version for the running CPU is selected at load
+ * time. Define MT64_NO_CLONES to compile the functions as they are.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+    && defined(__linux__) && !defined(MT64_NO_CLONES)
+#define MT64_VECTORIZE                                                  \
+    __attribute__((target_clones("avx512f", "avx2", "default"),        \
+                   optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#else
+#define MT64_VECTORIZE
+#endif
+
+/**
+ * @class mt64_multi
+ * @brief many mt64 generators which have different parameters and
+ * same mexp.
+ *
+ * States and parameters of generators are kept in structure of
+ * arrays layout, and all generators are advanced together using
+ * AVX-512 or AVX2 if they are available at compile time. Each
+ * generator is called a lane. A lane generates the same sequence as
+ * mt64 with the same parameter and the same seed.
+ *
+ * Example:
+ * <pre>
+ * mt64_multi mul(params, n);
+ * mul.seed(seeds);
+ * const uint64_t * r = mul.next(); // r[i] is the output of lane i
+ * </pre>
+ */
+class mt64_multi {
+public:
+    /**
+     * Constructor
+     * @tparam P parameter class which has members mexp, pos, mat,
+     * tmsk1 and tmsk2, like mt64_param.
+     * @param params parameters of lanes, all of them must have the
+     * same mexp.
+     * @param num number of lanes.
+     */
+    template<typename P>
+    mt64_multi(const P params[], int num) {
+        if (num <= 0) {
+            throw std::invalid_argument("number of lanes must be positive");
+        }
+        mexp = params[0].mexp;
+        size = mexp / 64 + 1;
+        lanes = num;
+        width = (num + vector_lanes - 1) / vector_lanes * vector_lanes;
+        lower_mask = ~UINT64_C(0) >> (mexp % 64);
+        upper_mask = ~lower_mask;
+        pos.resize(width);
+        mat.resize(width);
+        tmsk1.resize(width);
+        tmsk2.resize(width);
+        for (int i = 0; i < width; i++) {
+            // padding lanes use parameters of lane 0 and are never seeded.
+            const P& p = (i < num) ? params[i] : params[0];
+            if (p.mexp != mexp) {
+                throw std::invalid_argument("mexp of lanes must be same");
+            }
+            if (p.pos < 1 || p.pos >= size) {
+                throw std::invalid_argument("pos is out of range");
+            }
+            pos[i] = p.pos;
+            mat[i] = p.mat;
+            tmsk1[i] = p.tmsk1;
+            tmsk2[i] = p.tmsk2;
+        }
+        state.assign(static_cast<size_t>(size) * width, 0);
+        output.assign(static_cast<size_t>(size) * width, 0);
+        index = size;
+    }
+
+    /**
+     * initialize all lanes by different seeds.
+     * @param seeds array of seeds, whose length is number of lanes.
+     */
+    void seed(const uint64_t seeds[]) {
+        for (int i = 0; i < lanes; i++) {
+            seed_lane(i, seeds[i]);
+        }
+        index = size;
+    }
+
+    /**
+     * initialize lane i by seed + i.
+     * @param seed seed of lane 0
+     */
+    void seed(uint64_t seed) {
+        for (int i = 0; i < lanes; i++) {
+            seed_lane(i, seed + i);
+        }
+        index = size;
+    }
+
+    /**
+     * generate one number for each lane.
+     * @return pointer to outputs, the i-th element is the output of
+     * lane i. It is valid until next call of next() or fill().
+     */
+    const uint64_t * next() {
+        if (index >= size) {
+            refill();
+            index = 0;
+        }
+        return &output[static_cast<size_t>(index++) * width];
+    }
+
+    /**
+     * generate rows numbers for each lane.
+     * @param array output, array[r * getLanes() + i] is the r-th
+     * output of lane i.
+     * @param rows number of outputs of each lane.
+     */
+    void fill(uint64_t array[], long rows) {
+        for (long r = 0; r < rows; r++) {
+            const uint64_t * p = next();
+            for (int i = 0; i < lanes; i++) {
+                array[r * lanes + i] = p[i];
+            }
+        }
+    }
+
+    int getLanes() const {
+        return lanes;
+    }
+
+    int getMexp() const {
+        return mexp;
+    }
+private:
+#if defined(__AVX512F__)
+    enum {vector_lanes = 8};
+#elif defined(__AVX2__)
+    enum {vector_lanes = 4};
+#else
+    enum {vector_lanes = 1};
+#endif
+    enum {tsl1 = 17, tsl2 = 37};
+
+    uint64_t& at(int row, int lane) {
+        return state[static_cast<size_t>(row) * width + lane];
+    }
+
+    /**
+     * same as mt64::seed()
+     */
+    void seed_lane(int lane, uint64_t seed) {
+        at(0, lane) = seed;
+        for (int i = 1; i < size; i++) {
+            uint64_t prev = at(i - 1, lane);
+            at(i, lane) = UINT64_C(6364136223846793005)
+                * (prev ^ (prev >> 62)) + i;
+        }
+    }
+
+    /**
+     * Advance all lanes by size steps and temper them. Rows are
+     * updated in order from 0, which is same as calling
+     * mt64::next_state() size times. Each lane reads the row
+     * row + pos of its own, so the row is gathered.
+     */
+    void refill() {
+        for (int lane = 0; lane < width; lane += vector_lanes) {
+            refill_lanes(lane);
+        }
+    }
+
+#if defined(__AVX512F__)
+    void refill_lanes(int lane) {
+        const __m512i upper = _mm512_set1_epi64(upper_mask);
+        const __m512i lower = _mm512_set1_epi64(lower_mask);
+        const __m512i one = _mm512_set1_epi64(1);
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i step = _mm512_set1_epi64(width);
+        const __m512i total = _mm512_set1_epi64(
+            static_cast<int64_t>(size) * width);
+        const __m512i tm0 = _mm512_set1_epi64(tmsk0);
+        const __m512i vmat = load(&mat[lane]);
+        const __m512i vtm1 = load(&tmsk1[lane]);
+        const __m512i vtm2 = load(&tmsk2[lane]);
+        // index of row (i + pos) of each lane
+        __m512i idx;
+        {
+            int64_t tmp[8];
+            for (int j = 0; j < 8; j++) {
+                tmp[j] = static_cast<int64_t>(pos[lane + j]) * width
+                    + lane + j;
+            }
+            idx = _mm512_loadu_si512(tmp);
+        }
+        const long long * base
+            = reinterpret_cast<const long long *>(&state[0]);
+        for (int i = 0; i < size; i++) {
+            int next = (i + 1 == size) ? 0 : i + 1;
+            __m512i cur = load(&at(i, lane));
+            __m512i nxt = load(&at(next, lane));
+            __m512i x = _mm512_or_si512(_mm512_and_si512(cur, upper),
+                                        _mm512_and_si512(nxt, lower));
+            __m512i y = _mm512_i64gather_epi64(idx, base, 8);
+            y = _mm512_xor_si512(y, _mm512_srli_epi64(x, 1));
+            __m512i m = _mm512_sub_epi64(zero, _mm512_and_si512(x, one));
+            y = _mm512_xor_si512(y, _mm512_and_si512(m, vmat));
+            store(&at(i, lane), y);
+            y = _mm512_xor_si512(y, _mm512_and_si512(
+                                     _mm512_srli_epi64(y, 29), tm0));
+            y = _mm512_xor_si512(y, _mm512_and_si512(
+                                     _mm512_slli_epi64(y, tsl1), vtm1));
+            y = _mm512_xor_si512(y, _mm512_and_si512(
+                                     _mm512_slli_epi64(y, tsl2), vtm2));
+            y = _mm512_xor_si512(y, _mm512_srli_epi64(y, 43));
+            store(&output[static_cast<size_t>(i) * width + lane], y);
+            idx = _mm512_add_epi64(idx, step);
+            __mmask8 over = _mm512_cmpge_epi64_mask(idx, total);
+            idx = _mm512_mask_sub_epi64(idx, over, idx, total);
+        }
+    }
+
+    static __m512i load(const uint64_t * p) {
+        return _mm512_loadu_si512(p);
+    }
+
+    static void store(uint64_t * p, __m512i x) {
+        _mm512_storeu_si512(p, x);
+    }
+#elif defined(__AVX2__)
+    void refill_lanes(int lane) {
+        const __m256i upper = _mm256_set1_epi64x(upper_mask);
+        const __m256i lower = _mm256_set1_epi64x(lower_mask);
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i step = _mm256_set1_epi64x(width);
+        const __m256i total = _mm256_set1_epi64x(
+            static_cast<int64_t>(size) * width);
+        const __m256i last = _mm256_set1_epi64x(
+            static_cast<int64_t>(size) * width - 1);
+        const __m256i tm0 = _mm256_set1_epi64x(tmsk0);
+        const __m256i vmat = load(&mat[lane]);
+        const __m256i vtm1 = load(&tmsk1[lane]);
+        const __m256i vtm2 = load(&tmsk2[lane]);
+        // index of row (i + pos) of each lane
+        __m256i idx = _mm256_set_epi64x(
+            static_cast<int64_t>(pos[lane + 3]) * width + lane + 3,
+            static_cast<int64_t>(pos[lane + 2]) * width + lane + 2,
+            static_cast<int64_t>(pos[lane + 1]) * width + lane + 1,
+            static_cast<int64_t>(pos[lane]) * width + lane);
+        const long long * base
+            = reinterpret_cast<const long long *>(&state[0]);
+        for (int i = 0; i < size; i++) {
+            int next = (i + 1 == size) ? 0 : i + 1;
+            __m256i cur = load(&at(i, lane));
+            __m256i nxt = load(&at(next, lane));
+            __m256i x = _mm256_or_si256(_mm256_and_si256(cur, upper),
+                                        _mm256_and_si256(nxt, lower));
+            __m256i y = _mm256_i64gather_epi64(base, idx, 8);
+            y = _mm256_xor_si256(y, _mm256_srli_epi64(x, 1));
+            __m256i m = _mm256_sub_epi64(zero, _mm256_and_si256(x, one));
+            y = _mm256_xor_si256(y, _mm256_and_si256(m, vmat));
+            store(&at(i, lane), y);
+            y = _mm256_xor_si256(y, _mm256_and_si256(
+                                     _mm256_srli_epi64(y, 29), tm0));
+            y = _mm256_xor_si256(y, _mm256_and_si256(
+                                     _mm256_slli_epi64(y, tsl1), vtm1));
+            y = _mm256_xor_si256(y, _mm256_and_si256(
+                                     _mm256_slli_epi64(y, tsl2), vtm2));
+            y = _mm256_xor_si256(y, _mm256_srli_epi64(y, 43));
+            store(&output[static_cast<size_t>(i) * width + lane], y);
+            idx = _mm256_add_epi64(idx, step);
+            __m256i over = _mm256_cmpgt_epi64(idx, last);
+            idx = _mm256_sub_epi64(idx, _mm256_and_si256(over, total));
+        }
+    }
+
+    static __m256i load(const uint64_t * p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    static void store(uint64_t * p, __m256i x) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), x);
+    }
+#else
+    void refill_lanes(int lane) {
+        int p = pos[lane];
+        for (int i = 0; i < size; i++) {
+            int next = (i + 1 == size) ? 0 : i + 1;
+            uint64_t x = (at(i, lane) & upper_mask)
+                | (at(next, lane) & lower_mask);
+            uint64_t y = at(p, lane) ^ (x >> 1);
+            if (x & 1) {
+                y ^= mat[lane];
+            }
+            at(i, lane) = y;
+            y ^= (y >> 29) & tmsk0;
+            y ^= (y << tsl1) & tmsk1[lane];
+            y ^= (y << tsl2) & tmsk2[lane];
+            y ^= (y >> 43);
+            output[static_cast<size_t>(i) * width + lane] = y;
+            p++;
+            if (p == size) {
+                p = 0;
+            }
+        }
+    }
+#endif
+    static const uint64_t tmsk0 = UINT64_C(0x5555555555555555);
+    int mexp;
+    int size;
+    int lanes;
+    int width;
+    int index;
+    uint64_t upper_mask;
+    uint64_t lower_mask;
+    std::vector<int> pos;
+    std::vector<uint64_t> mat;
+    std::vector<uint64_t> tmsk1;
+    std::vector<uint64_t> tmsk2;
+    std::vector<uint64_t> state;
+    std::vector<uint64_t> output;
+};
+
+/**
+ * @class mt64_block
+ * @brief single mt64 generator which generates size words at once.
+ *
+ * The recurrence state[i] = state[i + pos] ^ f(state[i], state[i + 1])
+ * is computed in three loops, i + pos < size, i + pos >= size and
+ * the last word, so that compilers can vectorize the loops. A loop is
+ * vectorized with full width W when W <= pos, W <= size - pos and
+ * (size - pos) % W == 0, which is the pos searched by dcmt64
+ * --simd-pos W. Other pos work correctly, too. The loops are compiled
+ * with MT64_VECTORIZE, so W is 8 on CPUs with AVX-512 and 4 on CPUs
+ * with AVX2 whatever the compile options are.
+ */
+class mt64_block {
+public:
+    /**
+     * Constructor
+     * @tparam P parameter class which has members mexp, pos, mat,
+     * tmsk1 and tmsk2, like mt64_param.
+     * @param param parameter
+     */
+    template<typename P>
+    explicit mt64_block(const P& param) {
+        mexp = param.mexp;
+        size = mexp / 64 + 1;
+        pos = param.pos;
+        if (pos < 1 || pos >= size) {
+            throw std::invalid_argument("pos must be 1 <= pos < size");
+        }
+        mat = param.mat;
+        tmsk1 = param.tmsk1;
+        tmsk2 = param.tmsk2;
+        lower_mask = ~UINT64_C(0) >> (mexp % 64);
+        upper_mask = ~lower_mask;
+        state.resize(size);
+        output.resize(size);
+        index = size;
+    }
+
+    /**
+     * same as mt64::seed()
+     * @param seed seed
+     */
+    void seed(uint64_t seed) {
+        state[0] = seed;
+        for (int i = 1; i < size; i++) {
+            state[i] = UINT64_C(6364136223846793005)
+                * (state[i - 1] ^ (state[i - 1] >> 62)) + i;
+        }
+        index = size;
+    }
+
+    /**
+     * @return next output
+     */
+    uint64_t next() {
+        if (index >= size) {
+            refill();
+            index = 0;
+        }
+        return output[index++];
+    }
+
+    /**
+     * generate num outputs.
+     * @param array output
+     * @param num number of outputs
+     */
+    MT64_VECTORIZE
+    void fill(uint64_t array[], long num) {
+        long i = 0;
+        while (i < num) {
+            if (index >= size) {
+                refill();
+                index = 0;
+            }
+            long len = size - index;
+            if (len > num - i) {
+                len = num - i;
+            }
+            for (long j = 0; j < len; j++) {
+                array[i + j] = output[index + j];
+            }
+            index += static_cast<int>(len);
+            i += len;
+        }
+    }
+
+    int getMexp() const {
+        return mexp;
+    }
+private:
+    enum {tsl1 = 17, tsl2 = 37};
+    static const uint64_t tmsk0 = UINT64_C(0x5555555555555555);
+    int mexp;
+    int size;
+    int pos;
+    int index;
+    uint64_t mat;
+    uint64_t tmsk1;
+    uint64_t tmsk2;
+    uint64_t upper_mask;
+    uint64_t lower_mask;
+    std::vector<uint64_t> state;
+    std::vector<uint64_t> output;
+
+    uint64_t twist(uint64_t a, uint64_t b) const {
+        uint64_t x = (a & upper_mask) | (b & lower_mask);
+        return (x >> 1) ^ ((0 - (x & 1)) & mat);
+    }
+
+    /**
+     * same as calling mt64::next_state() size times.
+     */
+    MT64_VECTORIZE
+    void refill() {
+        uint64_t * st = &state[0];
+        int i = 0;
+        for (; i < size - pos; i++) {
+            st[i] = st[i + pos] ^ twist(st[i], st[i + 1]);
+        }
+        for (; i < size - 1; i++) {
+            st[i] = st[i + pos - size] ^ twist(st[i], st[i + 1]);
+        }
+        st[size - 1] = st[pos - 1] ^ twist(st[size - 1], st[0]);
+        uint64_t * out = &output[0];
+        for (int j = 0; j < size; j++) {
+            uint64_t y = st[j];
+            y ^= (y >> 29) & tmsk0;
+            y ^= (y << tsl1) & tmsk1;
+            y ^= (y << tsl2) & tmsk2;
+            y ^= y >> 43;
+            out[j] = y;
+        }
+    }
+};
+
+/**
+ * measure generation speed of mt64_block.
+ * @tparam P parameter class like mt64_param
+ * @param param parameter
+ * @param num number of outputs generated
+ * @return million outputs per second
+ */
+template<typename P>
+double mt64_speed(const P& param, long num = 1L << 24) {
+    using namespace std::chrono;
+    mt64_block gen(param);
+    gen.seed(1);
+    std::vector<uint64_t> buffer(4096);
+    uint64_t sum = 0;
+    steady_clock::time_point start = steady_clock::now();
+    for (long i = 0; i < num; i += 4096) {
+        gen.fill(&buffer[0], 4096);
+        sum ^= buffer[4095];
+    }
+    double sec = duration<double>(steady_clock::now() - start).count();
+    // keep the loop from being removed
+    if (sum == 1 && sec < 0) {
+        return 0;
+    }
+    return num / sec / 1.0e6;
+}
+
+#endif // MT64RUNTIME_HPP
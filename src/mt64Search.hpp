@@ -22,9 +22,12 @@
 #include <iomanip>
 #include <cstdlib>
 #include <sstream>
+#include <vector>
+#include <atomic>
 #include <MTToolBox/ReducibleGenerator.hpp>
 #include <MTToolBox/TemperingCalculatable.hpp>
 #include <MTToolBox/util.hpp>
+#include "deadline.hpp"
 
 namespace MTToolBox {
     using namespace NTL;
@@ -91,6 +94,44 @@ namespace MTToolBox {
             return s;
         }
 
+        /**
+         * parse a line outputted by get_string().
+         * Fields after tmsk2, for example delta, are not parsed.
+         * @param str parameter line
+         * @return true if str has all fields and pos is valid
+         */
+        bool parse(const string& str) {
+            const char * p = str.c_str();
+            char * q;
+            uint64_t v[6];
+            for (int i = 0; i < 6; i++) {
+                int base = (i < 3) ? 10 : 16;
+                v[i] = strtoull(p, &q, base);
+                if (q == p) {
+                    return false;
+                }
+                while (*q == ' ') {
+                    q++;
+                }
+                if (i < 5 && *q != ',') {
+                    return false;
+                }
+                p = q + 1;
+            }
+            // 1 <= pos < size is required by the state transition
+            if (v[0] < 64 || v[2] < 1 || v[2] >= v[0] / 64 + 1) {
+                return false;
+            }
+            mexp = static_cast<int>(v[0]);
+            id = static_cast<uint32_t>(v[1]);
+            pos = static_cast<int>(v[2]);
+            mat = v[3];
+            tmsk1 = v[4];
+            tmsk2 = v[5];
+            seq = 0;
+            return true;
+        }
+
         /**
          * This method is used for DEBUG.
          * @return string of parameters.
@@ -109,6 +150,31 @@ namespace MTToolBox {
         }
     };
 
+    /**
+     * read parameter lines, which are outputted by dcmt64.
+     * Empty lines and lines start with # are skipped.
+     * @param is input stream
+     * @param params parameters read are added to this vector
+     * @param bad the first wrong line, if any
+     * @return false if is has a wrong line
+     */
+    inline bool read_params(istream& is, vector<mt64_param>& params,
+                            string& bad) {
+        string line;
+        while (getline(is, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            mt64_param p;
+            if (!p.parse(line)) {
+                bad = line;
+                return false;
+            }
+            params.push_back(p);
+        }
+        return true;
+    }
+
     /**
      * @class mt64
      * @brief DSFMT generator class used for dynamic creation
@@ -135,7 +201,10 @@ namespace MTToolBox {
             param.tmsk2 = 0;
             index = 0;
             fixedPOS = -1;
+            simdWidth = 0;
             reverse_bit_flag = false;
+            deadline = 0;
+            tmpidx = 0;
             make_mask(mexp);
         }
 
@@ -155,7 +224,10 @@ namespace MTToolBox {
             }
             index = src.index;
             fixedPOS = src.fixedPOS;
+            simdWidth = src.simdWidth;
             reverse_bit_flag = src.reverse_bit_flag;
+            deadline = src.deadline;
+            tmpidx = src.tmpidx;
             lower_mask = src.lower_mask;
             upper_mask = src.upper_mask;
         }
@@ -173,7 +245,10 @@ namespace MTToolBox {
             }
             index = 0;
             fixedPOS = -1;
+            simdWidth = 0;
             reverse_bit_flag = false;
+            deadline = 0;
+            tmpidx = 0;
             make_mask(src_param.mexp);
         }
 
@@ -196,15 +271,21 @@ namespace MTToolBox {
 
         /**
          * Important state transition function.
+         * throws time_limit_error if the deadline has passed.
          */
         void next_state() {
-            index = (index + 1) % size;
-            uint64_t x = (state[index] & upper_mask)
-                | (state[(index + 1) % size] & lower_mask);
-            state[index] = state[(index + param.pos) % size] ^ (x >> 1);
-            if (x & 1) {
-                state[index] ^= param.mat;
-            }
+            step();
+        }
+
+        /**
+         * state transition without tempering. This is not virtual,
+         * and used by RecursionSearch, because the minimal polynomial
+         * does not depend on tempering.
+         * @return the new word of internal state
+         */
+        uint64_t generateRaw() {
+            step();
+            return state[index];
         }
 
         /**
@@ -241,7 +322,6 @@ namespace MTToolBox {
             } else {
                 w = generate();
             }
-            w = generate();
             uint64_t mask = 0;
             mask = ~mask;
             mask = mask << (64 - bit_len);
@@ -256,6 +336,11 @@ namespace MTToolBox {
         void setUpParam(ParameterGenerator& mix) {
             if (fixedPOS > 0) {
                 param.pos = fixedPOS;
+            } else if (simdWidth > 0) {
+                // pos = size - j * W, W <= pos
+                int num = size / simdWidth - 1;
+                int j = static_cast<int>(mix.getUint64() % num) + 1;
+                param.pos = size - j * simdWidth;
             } else {
                 param.pos = mix.getUint64() % (size - 1) + 1;
             }
@@ -333,6 +418,10 @@ namespace MTToolBox {
             return param.get_string();
         }
 
+        const mt64_param& getParam() const {
+            return param;
+        }
+
         /**
          * This method is called by the functions in search_temper.hpp
          * to calculate the equidistribution properties from LSB
@@ -371,6 +460,37 @@ namespace MTToolBox {
             fixedPOS = value;
         }
 
+        /**
+         * limit pos so that the recurrence can be computed by vectors
+         * of width words: width <= pos, width <= size - pos and
+         * (size - pos) % width == 0. See mt64_block in
+         * mt64Runtime.hpp.
+         * @param width vector width in 64-bit words, 0 means no limit.
+         * size must be 2 * width or larger.
+         */
+        void setSimdPos(int width) {
+            simdWidth = width;
+        }
+
+        /**
+         * set the deadline flag. clones of this generator, which are
+         * made by MTToolBox algorithms, share the flag.
+         * @param flag the flag which becomes true at the deadline,
+         * NULL means no deadline.
+         */
+        void setDeadline(const std::atomic<bool> * flag) {
+            deadline = flag;
+        }
+
+        /**
+         * throws time_limit_error if the deadline has passed.
+         */
+        void checkDeadline() const {
+            if (deadline != 0 && deadline->load(std::memory_order_relaxed)) {
+                throw time_limit_error();
+            }
+        }
+
         /**
          * This method is called by functions in the file search_temper.hpp
          * Do not remove this.
@@ -420,6 +540,29 @@ namespace MTToolBox {
             tmpidx = idx;
         }
     private:
+        void step() {
+            checkDeadline();
+            // index + 1 and index + pos are less than 2 * size
+            index++;
+            if (index >= size) {
+                index = 0;
+            }
+            int next = index + 1;
+            if (next >= size) {
+                next -= size;
+            }
+            int mid = index + param.pos;
+            if (mid >= size) {
+                mid -= size;
+            }
+            uint64_t x = (state[index] & upper_mask)
+                | (state[next] & lower_mask);
+            state[index] = state[mid] ^ (x >> 1);
+            if (x & 1) {
+                state[index] ^= param.mat;
+            }
+        }
+
         void make_mask(int mexp) {
             int bit = mexp % 64;
             lower_mask = 0;
@@ -433,6 +576,7 @@ namespace MTToolBox {
         static const uint64_t tmsk0 = UINT64_C(0x5555555555555555);
         enum {tsl1 = 17, tsl2 = 37};
         int fixedPOS;
+        int simdWidth;
         int size;
         int index;
         int tmpidx;
@@ -441,6 +585,7 @@ namespace MTToolBox {
         uint64_t upper_mask;
         uint64_t lower_mask;
         bool reverse_bit_flag;
+        const std::atomic<bool> * deadline;
     };
 }
 
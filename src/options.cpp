@@ -15,26 +15,29 @@
  * LICENSE
  */
 #include "options.h"
+#include "TemperingTable.hpp"
+#include "stattest.h"
+#include "deadline.hpp"
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <getopt.h>
 #include <errno.h>
+#include <limits.h>
 
 namespace {
     void output_help(std::string& pgm);
+    bool parse_id_range(options& opt, const char * str);
+    bool parse_partition(options& opt, const char * str);
+    bool parse_memory_size(uint64_t& size, const char * str);
 }
 
 /**
- * command line option parser
- * @param opt a structure to keep the result of parsing
- * @param argc number of command line arguments
- * @param argv command line arguments
- * @param start default start value
- * @return command line options have error, or not
+ * set default values of options.
+ * mexp, id, logcount and max_defect should be set after this.
+ * @param opt options
  */
-bool parse_opt(options& opt, int argc, char **argv) {
-    using namespace std;
+void init_opt(options& opt) {
     opt.verbose = false;
     opt.mexp = 0;
     opt.count = 1;
@@ -42,10 +45,68 @@ bool parse_opt(options& opt, int argc, char **argv) {
     opt.outfilename = "";
     opt.logfilename = "";
     opt.fixedPOS = -1;
+    opt.simd_pos = 0;
+    opt.defer_speed = false;
     opt.id = -1;
+    opt.last_id = -1;
+    opt.threads = 0;
     opt.seq = -1;
     opt.logcount = -1;
     opt.max_defect = -1;
+    opt.stat_tests = 0;
+    opt.time_limit = 0;
+    opt.deadline = 0;
+    opt.algorithm = "partial";
+    opt.charpoly = "algebraic";
+    opt.max_lsb_defect = -1;
+    opt.retemper_file = "";
+    opt.campaign_file = "";
+    opt.memory_limit = 0;
+    opt.memory = 0;
+    opt.part_index = 0;
+    opt.part_count = 0;
+    opt.flush_interval = 0;
+    opt.profile = false;
+    opt.poly = false;
+    opt.coverage_file = "";
+    opt.coverage = 0;
+    opt.tempering = MTToolBox::tempering_table()[0].name();
+    opt.resolutions = MTToolBox::all_resolutions;
+}
+
+/**
+ * supported mersenne exponents, terminated by -1.
+ */
+const int allowed_mexp[] = {521, 607, 1279,
+                            2203, 2281, 3217, 4253,
+                            4423, 9689, 9941, 11213, 19937,
+                            -1};
+
+/**
+ * @param mexp mersenne exponent
+ * @return true if mexp is supported
+ */
+bool is_allowed_mexp(int mexp) {
+    for (int i = 0; allowed_mexp[i] > 0; i++) {
+        if (mexp == allowed_mexp[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * command line option parser
+ * @param opt a structure to keep the result of parsing
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @param start default start value
+ * @return command line options have error, or not
+ */
+bool parse_opt(options& opt, int argc, char **argv) {
+    using namespace std;
+    init_opt(opt);
+    bool lsb = false;
     int c;
     bool error = false;
     string pgm = argv[0];
@@ -54,6 +115,8 @@ bool parse_opt(options& opt, int argc, char **argv) {
         {"file", required_argument, NULL, 'f'},
         {"logfile", required_argument, NULL, 'L'},
         {"id", required_argument, NULL, 'I'},
+        {"id-range", required_argument, NULL, 'R'},
+        {"threads", required_argument, NULL, 't'},
         {"start-seq", required_argument, NULL, 'S'},
         {"count", required_argument, NULL, 'c'},
         {"log-count", required_argument, NULL, 'C'},
@@ -61,10 +124,26 @@ bool parse_opt(options& opt, int argc, char **argv) {
         {"mexp", required_argument, NULL, 'm'},
         {"fixed-pos", required_argument, NULL, 'X'},
         {"max-defect", required_argument, NULL, 'M'},
+        {"stat-test", optional_argument, NULL, 'T'},
+        {"time-limit", required_argument, NULL, 'D'},
+        {"algorithm", required_argument, NULL, 'A'},
+        {"lsb-defect", optional_argument, NULL, 'B'},
+        {"simd-pos", required_argument, NULL, 'P'},
+        {"retemper", required_argument, NULL, 'r'},
+        {"partition", required_argument, NULL, 'p'},
+        {"shared-output", optional_argument, NULL, 'O'},
+        {"charpoly", required_argument, NULL, 'K'},
+        {"profile", no_argument, NULL, 'Q'},
+        {"poly", no_argument, NULL, 'y'},
+        {"coverage", required_argument, NULL, 'G'},
+        {"tempering", required_argument, NULL, 'W'},
+        {"resolutions", required_argument, NULL, 'V'},
+        {"campaign", required_argument, NULL, 'J'},
+        {"memory-limit", required_argument, NULL, 'x'},
         {NULL, 0, NULL, 0}};
     errno = 0;
     for (;;) {
-        c = getopt_long(argc, argv, "vs:f:c:C:m:M:X:S:I:", longopts, NULL);
+        c = getopt_long(argc, argv, "vs:f:c:C:m:M:X:S:I:R:t:T::D:A:B::P:r:p:O::K:QyG:W:V:J:x:", longopts, NULL);
         if (error) {
             break;
         }
@@ -86,6 +165,19 @@ bool parse_opt(options& opt, int argc, char **argv) {
                 cerr << "id must be a number" << endl;
             }
             break;
+        case 'R':
+            if (!parse_id_range(opt, optarg)) {
+                error = true;
+                cerr << "id-range must be START:END" << endl;
+            }
+            break;
+        case 't':
+            opt.threads = strtol(optarg, NULL, 10);
+            if (errno || opt.threads < 0) {
+                error = true;
+                cerr << "threads must be a non negative number" << endl;
+            }
+            break;
         case 'S':
             opt.seq = strtoull(optarg, NULL, 0);
             if (errno) {
@@ -114,6 +206,104 @@ bool parse_opt(options& opt, int argc, char **argv) {
                 cerr << "fixed pos must be a number" << endl;
             }
             break;
+        case 'T':
+            if (!parse_stat_tests(optarg, opt.stat_tests)) {
+                error = true;
+                cerr << "unknown statistical test" << endl;
+            }
+            break;
+        case 'D':
+            opt.time_limit = strtod(optarg, NULL);
+            if (errno || opt.time_limit <= 0) {
+                error = true;
+                cerr << "time-limit must be a positive number" << endl;
+            }
+            break;
+        case 'A':
+            opt.algorithm = optarg;
+            if (opt.algorithm != "partial" && opt.algorithm != "best") {
+                error = true;
+                cerr << "algorithm must be partial or best" << endl;
+            }
+            break;
+        case 'K':
+            opt.charpoly = optarg;
+            if (opt.charpoly != "algebraic" && opt.charpoly != "bm") {
+                error = true;
+                cerr << "charpoly must be algebraic or bm" << endl;
+            }
+            break;
+        case 'B':
+            lsb = true;
+            if (optarg != NULL) {
+                opt.max_lsb_defect = strtoull(optarg, NULL, 0);
+                if (errno) {
+                    error = true;
+                    cerr << "lsb-defect must be a number" << endl;
+                }
+            }
+            break;
+        case 'P':
+            opt.simd_pos = strtol(optarg, NULL, 10);
+            if (errno || opt.simd_pos <= 0) {
+                error = true;
+                cerr << "simd-pos must be a positive number" << endl;
+            }
+            break;
+        case 'r':
+            opt.retemper_file = optarg;
+            break;
+        case 'J':
+            opt.campaign_file = optarg;
+            break;
+        case 'x':
+            if (!parse_memory_size(opt.memory_limit, optarg)) {
+                error = true;
+                cerr << "memory-limit must be a positive number, with"
+                     << " suffix K, M or G" << endl;
+            }
+            break;
+        case 'p':
+            if (!parse_partition(opt, optarg)) {
+                error = true;
+                cerr << "partition must be I/N, 0 <= I < N" << endl;
+            }
+            break;
+        case 'O':
+            opt.flush_interval = 60;
+            if (optarg != NULL) {
+                opt.flush_interval = strtod(optarg, NULL);
+                if (errno || opt.flush_interval <= 0) {
+                    error = true;
+                    cerr << "shared-output must be a positive number" << endl;
+                }
+            }
+            break;
+        case 'Q':
+            opt.profile = true;
+            break;
+        case 'y':
+            opt.poly = true;
+            break;
+        case 'G':
+            opt.coverage_file = optarg;
+            break;
+        case 'V':
+            if (!MTToolBox::parse_resolutions(optarg, opt.resolutions)) {
+                error = true;
+                cerr << "resolutions must be a list of 1 to 64, like"
+                     << " 32,53,64 or 1-32" << endl;
+            }
+            break;
+        case 'W':
+            opt.tempering = optarg;
+            if (opt.tempering != "auto"
+                && MTToolBox::find_tempering(opt.tempering) == 0) {
+                error = true;
+                cerr << "tempering must be auto or one of "
+                     << MTToolBox::tempering_names() << endl;
+            }
+            break;
         case 'v':
             opt.verbose = true;
             break;
@@ -143,15 +333,38 @@ bool parse_opt(options& opt, int argc, char **argv) {
             break;
         }
     }
+    bool retemper = !opt.retemper_file.empty();
+    bool campaign = !opt.campaign_file.empty();
+    if (retemper && campaign) {
+        cerr << "retemper and campaign can't be used together" << endl;
+        error = true;
+    }
+    // ids of campaign are given by the file
+    if ((retemper || campaign) && opt.id < 0 && opt.last_id < 0) {
+        opt.id = 0;
+    }
     if (opt.id < 0 || opt.id >= INT64_C(0x100000000)) {
         cerr << "id must be 0 <= id < 2^32-1" << endl;
         error = true;
     }
+    if (opt.last_id >= 0) {
+        if (opt.last_id < opt.id || opt.last_id >= INT64_C(0x100000000)) {
+            cerr << "id-range must be START <= END < 2^32-1" << endl;
+            error = true;
+        }
+    }
+    if (opt.time_limit > 0) {
+        opt.deadline = Deadline::now() + opt.time_limit;
+    }
     if (opt.logcount <= 0) {
         opt.logcount = opt.mexp / 2;
     }
+    // without mexp, retemper does not limit defects by default
     if (opt.max_defect < 0) {
-        opt.max_defect = opt.mexp * 64;
+        opt.max_defect = opt.mexp > 0 ? opt.mexp * 64 : INT_MAX;
+    }
+    if (lsb && opt.max_lsb_defect < 0) {
+        opt.max_lsb_defect = opt.mexp > 0 ? opt.mexp * 64 : INT_MAX;
     }
     if (opt.mexp > 0 && opt.fixedPOS > 0) {
         int size = opt.mexp / 64 + 1;
@@ -161,22 +374,22 @@ bool parse_opt(options& opt, int argc, char **argv) {
             error = true;
         }
     }
+    if (opt.mexp > 0 && opt.simd_pos > 0) {
+        int size = opt.mexp / 64 + 1;
+        if (opt.fixedPOS > 0) {
+            cerr << "fixed-pos and simd-pos can't be used together" << endl;
+            error = true;
+        } else if (size < 2 * opt.simd_pos) {
+            cerr << "simd-pos must be <= " << dec << (size / 2) << endl;
+            error = true;
+        }
+    }
     if (error) {
         output_help(pgm);
         return false;
     }
-    static const int allowed_mexp[] = {521, 607, 1279,
-                                       2203, 2281, 3217, 4253,
-                                       4423, 9689, 9941, 11213, 19937,
-                                       -1};
-    bool found = false;
-    for (int i = 0; allowed_mexp[i] > 0; i++) {
-        if (opt.mexp == allowed_mexp[i]) {
-            found = true;
-            break;
-        }
-    }
-    if (! found) {
+    if (!((retemper || campaign) && opt.mexp == 0)
+        && !is_allowed_mexp(opt.mexp)) {
         error = true;
         cerr << "mexp must be one of ";
         for (int i = 0; allowed_mexp[i] > 0; i++) {
@@ -201,18 +414,49 @@ namespace {
         cerr << "usage:" << endl;
         cerr << pgm
              << " -m mexp"
-             << " -I id"
+             << " -I id|-R start:end"
              << " [-s seed] [-v] [-c count]"
              << " [-f outputfile]"
              << " [-l logfile]"
              << " [-S start_seq]"
              << " [-C log_count]"
+             << " [-t threads]"
              << " [-F fixed_pos]"
              << " [-M max_defect]"
+             << " [-T[tests]]"
+             << " [-D seconds]"
+             << " [-A algorithm]"
+
+             << " [-K charpoly]"
+             << " [-B[max]]"
+             << " [-P width]"
+             << " [-p i/n]"
+             << " [-O[sec]]"
+             << " [-Q]"
+             << " [-y]"
+             << " [-G coverage_file]"
+             << " [-W tempering]"
+             << " [-V resolutions]"
+             << " [-x size]"
+             << endl;
+        cerr << pgm
+             << " --retemper file [-m mexp] [options]"
+             << endl;
+        cerr << pgm
+             << " --campaign file [options]"
              << endl;
         static string help_string1 = "\n"
             "--mexp, -m mexp      mersenne exponent.\n"
             "--id, -I id          start id. The first id.\n"
+            "--id-range, -R start:end\n"
+            "                     search parameters for all ids from start to end\n"
+            "                     in one process. count is applied to each id.\n"
+            "                     dcmt64mpi splits the range into blocks of ranks,\n"
+            "                     and each rank searches its block by threads.\n"
+            "--threads, -t num    number of threads used by id-range search, or by\n"
+            "                     tempering search of algorithm best. 20 or more\n"
+            "                     threads make the best search look ahead.\n"
+            "                     default is number of hardware threads.\n"
             "--seed, -s seed      seed of randomness.\n"
             "--verbose, -v        Verbose mode. Output parameters, calculation time, etc.\n"
             "--count, -c count    Output count. The number of parameters to be outputted.\n"
@@ -223,7 +467,184 @@ namespace {
             "--log-count count    log output interval.\n"
             "--fixed-pos          fix the parameter pos to given value.\n"
             "--max-defect max     total dimensiton defect larger than max will be skipped.\n"
+            "--stat-test[=tests]  apply statistical tests to found parameters and\n"
+            "                     output p-values to log. tests is comma separated\n"
+            "                     list of lincomp, bspace and rank. default is all.\n"
+            "--time-limit, -D sec stop search after sec seconds, even in the middle\n"
+            "                     of a candidate. parameters found so far and a\n"
+            "                     status line are outputted.\n"
+            "--algorithm, -A alg  tempering parameter search algorithm. partial\n"
+            "                     (default) searches bit patterns of each mask,\n"
+            "                     best decides bits of both masks from MSB.\n"
+            "--charpoly, -K poly  polynomial tested in recursion search. algebraic\n"
+            "                     (default) calculates characteristic polynomial\n"
+            "                     from parameters, bm calculates minimal polynomial\n"
+            "                     of outputs by Berlekamp-Massey. found parameters\n"
+            "                     are the same.\n"
+            "--lsb-defect[=max]   calculate total dimension defect from LSB, too,\n"
+            "                     and output it after delta. defect from LSB\n"
+            "                     larger than max will be skipped.\n"
+            "--simd-pos, -P W     limit pos so that the recurrence can be computed\n"
+            "                     by vectors of W words, and output generation\n"
+            "                     speed of mt64_block in million words per second\n"
+            "                     as the last column. with several threads, the\n"
+            "                     speeds are measured after all searches end, and\n"
+            "                     parameters are outputted then.\n"
+            "--partition, -p i/n  split candidates of recursion into n disjoint\n"
+            "                     ranges and search only the i-th range, 0 <= i < n.\n"
+            "                     candidate k is decided by seed, start-seq and k,\n"
+            "                     so processes with different i never search the\n"
+            "                     same candidate.\n"
+            "--shared-output[=sec]\n"
+            "                     dcmt64mpi only. outputs of all ranks are written\n"
+            "                     to one parameter file and one log file by MPI-IO,\n"
+            "                     every sec seconds (default 60), instead of files\n"
+            "                     of each rank. -f is required. lines of ranks are\n"
+            "                     interleaved over flushes while searching, and\n"
+            "                     the files are rewritten in the order of id at\n"
+            "                     the end.\n"
+            "--poly, -y           output the characteristic polynomial as the last\n"
+            "                     field, in hexadecimal, bit i of which is the\n"
+            "                     coefficient of t^i. calc_equidist and check_indep\n"
+            "                     use it instead of calculating minimal polynomial.\n"
+            "--coverage, -G file  skip candidates of recursion search which are\n"
+            "                     recorded as reducible in file, and record\n"
+            "                     reducible candidates tested to it. with\n"
+            "                     --fixed-pos, candidates are (mexp, id, pos, seq),\n"
+            "                     independent of seed. otherwise pos is decided by\n"
+            "                     seed, start-seq and seq, and candidates are kept\n"
+            "                     for each seed and start-seq. file can be shared\n"
+            "                     by processes.\n"
+            "--resolutions, -V list\n"
+            "                     calculate k(v) only for v in list, like\n"
+            "                     32,53,64 or 1-32. delta and lsb_delta are sums of\n"
+            "                     defects of these v, and -M and -B are compared\n"
+            "                     with them. default is 1-64. k(v) is calculated\n"
+            "                     up to the largest v in list anyway, so only\n"
+            "                     lists whose largest v is less than 64 save\n"
+            "                     time, 32,53,64 does not.\n"
+            "--tempering, -W l1:l2:step\n"
+            "                     configuration of partial tempering search. l1\n"
+            "                     and l2 are numbers of bits of tmsk1 and tmsk2\n"
+            "                     searched, step is width of bit patterns, 3 to 8.\n"
+            "                     l1:l2 is 47:27, 40:20 or 32:16, default is\n"
+            "                     47:27:5. auto tries all configurations for\n"
+            "                     sample recursions and selects the one which\n"
+            "                     gives the most parameters whose defect is\n"
+            "                     within -M per second. when -M accepts the same\n"
+            "                     number of samples of all configurations, as\n"
+            "                     without -M, the one which improves mean defect\n"
+            "                     most per second is selected.\n"
+            "--memory-limit, -x size\n"
+            "                     limit of memory used by threads, like 512M or\n"
+            "                     4G. recursion search, tempering search and\n"
+            "                     equidistribution reserve their estimated memory\n"
+            "                     before they start, and wait while it does not\n"
+            "                     fit the limit. peak of the estimate and max rss\n"
+            "                     are outputted to log.\n"
+            "--profile, -Q        count cycles, instructions, L1D and LLC misses,\n"
+            "                     branch misses and page faults of recursion search,\n"
+            "                     tempering and equidistribution by perf_event_open,\n"
+            "                     and output totals of them to log at the end.\n"
+            "                     counters not supported are shown as -.\n"
+            "--retemper, -r file  read parameter lines from file, and search only\n"
+            "                     tempering parameters and equidistribution of\n"
+            "                     them again, in parallel. recursion search is\n"
+            "                     skipped. mexp and id are not required; if mexp\n"
+            "                     is given, parameters of other mexp are skipped.\n"
+            "--campaign, -J file  search parameters for all targets in file, in\n"
+            "                     one thread pool. each line of file is\n"
+            "                     mexp,id[:last_id][,count], count is -c by\n"
+            "                     default. mexp and id are not required. cost of\n"
+            "                     each id is estimated from seconds per candidate\n"
+            "                     measured for each mexp, the most expensive ids\n"
+            "                     are searched first so that all targets finish\n"
+            "                     together, and progress and ETA are outputted to\n"
+            "                     log every minute.\n"
             ;
         cerr << help_string1 << endl;
     }
+
+/**
+ * parse START:END form of id range
+ * @param opt id and last_id are set
+ * @param str command line argument
+ * @return true if str is valid
+ */
+    bool parse_id_range(options& opt, const char * str) {
+        char * p;
+        errno = 0;
+        opt.id = strtoll(str, &p, 0);
+        if (errno || p == str || *p != ':') {
+            return false;
+        }
+        str = p + 1;
+        opt.last_id = strtoll(str, &p, 0);
+        if (errno || p == str || *p != '\0') {
+            return false;
+        }
+        return true;
+    }
+
+/**
+ * parse I/N form of partition
+ * @param opt part_index and part_count are set
+ * @param str command line argument
+ * @return true if str is valid
+ */
+    bool parse_partition(options& opt, const char * str) {
+        char * p;
+        errno = 0;
+        opt.part_index = strtoll(str, &p, 0);
+        if (errno || p == str || *p != '/') {
+            return false;
+        }
+        str = p + 1;
+        opt.part_count = strtoll(str, &p, 0);
+        if (errno || p == str || *p != '\0') {
+            return false;
+        }
+        return opt.part_count > 0 && opt.part_index >= 0
+            && opt.part_index < opt.part_count;
+    }
+
+/**
+ * parse size of memory, a number followed by K, M or G
+ * @param size bytes
+ * @param str command line argument
+ * @return true if str is valid
+ */
+    bool parse_memory_size(uint64_t& size, const char * str) {
+        char * p;
+        errno = 0;
+        double value = strtod(str, &p);
+        if (errno || p == str || value <= 0) {
+            return false;
+        }
+        double unit = 1;
+        switch (*p) {
+        case 'K':
+        case 'k':
+            unit = 1024.0;
+            p++;
+            break;
+        case 'M':
+        case 'm':
+            unit = 1024.0 * 1024;
+            p++;
+            break;
+        case 'G':
+        case 'g':
+            unit = 1024.0 * 1024 * 1024;
+            p++;
+            break;
+        default:
+            break;
+        }
+        if (*p != '\0') {
+            return false;
+        }
+        size = static_cast<uint64_t>(value * unit);
+        return size > 0;
+    }
 }
@@ -21,13 +21,22 @@
 #include <inttypes.h>
 #include <string>
 
+class MemoryBudget;
+class CoverageMap;
+
 class options {
 public:
     int mexp;                   // mersenne exponent (required)
     int64_t id;                 // id (required)
+    int64_t last_id;            // last id of id range, -1 means single id
+    int threads;                // number of threads, 0 means auto
     bool verbose;               // verbose mode (optional)
     long seq;                   // start seq no (optional) -1 means use default
     int fixedPOS;               // fix pos parameter -1 means not fix
+    int simd_pos;               // vector width which pos fits, and speed
+                                // is measured. 0 means not used.
+    bool defer_speed;           // speed column is "-" and measured by
+                                // fill_speed() after worker threads end.
     uint64_t seed;              // if pos is fixed not used
     int max_defect;             // max defect.
                                 // defect larger than this will be skipped.
@@ -35,7 +44,42 @@ public:
     std::string logfilename;    // log output file
     long count;                 // number of parameters you want to get
     long logcount;              // count for log output
+    int stat_tests;             // statistical tests applied to found
+                                // parameters, 0 means no test.
+    double time_limit;          // time limit in seconds, 0 means no limit
+    double deadline;            // Deadline::now() at the time limit
+    std::string algorithm;      // tempering search, partial or best
+    std::string tempering;      // limit1:limit2:step of partial
+                                // tempering search, or auto
+    std::string charpoly;       // polynomial of recursion search,
+                                // algebraic or bm
+    uint64_t resolutions;       // bit v - 1 means k(v) is calculated
+    int max_lsb_defect;         // max defect from LSB, -1 means defect
+                                // from LSB is not calculated.
+    int64_t part_index;         // index of candidate partition
+    int64_t part_count;         // number of partitions, 0 means
+                                // MixedSequence is used.
+    std::string coverage_file;  // reducible candidates shared by
+                                // processes, empty means not used.
+    CoverageMap * coverage;     // map of coverage_file shared by threads,
+                                // NULL means each search reads the file.
+    bool poly;                  // output characteristic polynomial
+    bool profile;               // output hardware counters of phases
+    double flush_interval;      // dcmt64mpi writes outputs of all ranks
+                                // to shared files at this interval,
+                                // 0 means files of each rank.
+    std::string retemper_file;  // parameters whose tempering is searched
+                                // again, empty means normal search.
+    std::string campaign_file;  // targets of several mexp searched
+                                // together, empty means normal search.
+    uint64_t memory_limit;      // bytes of working sets of phases running
+                                // in parallel, 0 means no limit.
+    MemoryBudget * memory;      // budget shared by threads, NULL means
+                                // no limit.
 };
 
+void init_opt(options& opt);
 bool parse_opt(options& opt, int argc, char **argv);
+bool is_allowed_mexp(int mexp);
+extern const int allowed_mexp[];    // terminated by -1
 #endif // OPTIONS_H
@@ -0,0 +1,300 @@
+#pragma once
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+/**
+ * @file profile.hpp
+ *
+ * @brief hardware counters of phases of search.
+ *
+ * Counters are opened by perf_event_open for the calling thread and
+ * threads created after that, and they are read at the beginning and
+ * the end of each phase. Counts of a created thread are added to the
+ * counters only when the thread exits, so work of a thread is
+ * counted in a phase only if the thread is created and joined inside
+ * the phase. Counters which the kernel or the hardware
+ * does not support are reported as -. When profiling is disabled,
+ * ProfileScope only checks a null pointer.
+ *
+ * The counters are opened one by one, not as a group, because a group
+ * can't be inherited by threads. When there are more counters than
+ * the hardware has, the kernel multiplexes them, and a counter counts
+ * only while it is scheduled. The time the counter was enabled and
+ * the time it was running are read with the count, and the count of
+ * a phase is scaled by enabled / running of the phase, as perf stat
+ * does. Scaled counts are marked by *, and counters which never ran
+ * in a phase are reported as -.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "deadline.hpp"
+
+/**
+ * @class Profile
+ * @brief totals of counters of each phase.
+ */
+class Profile {
+public:
+    enum {CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES,
+          PAGE_FAULTS, NUM_COUNTERS};
+
+    /**
+     * value of a counter, with times read by
+     * PERF_FORMAT_TOTAL_TIME_ENABLED and PERF_FORMAT_TOTAL_TIME_RUNNING
+     */
+    struct reading {
+        uint64_t value;
+        uint64_t enabled;       // nanoseconds
+        uint64_t running;       // nanoseconds
+    };
+
+    /**
+     * Constructor
+     * @param enable open counters or not
+     */
+    explicit Profile(bool enable) {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            fd[i] = -1;
+        }
+        if (enable) {
+            open_counters();
+        }
+    }
+
+    ~Profile() {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            if (fd[i] >= 0) {
+                close(fd[i]);
+            }
+        }
+    }
+
+    /**
+     * read current values of counters.
+     * @param values NUM_COUNTERS values
+     */
+    void read_counters(reading values[]) const {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            values[i].value = 0;
+            values[i].enabled = 0;
+            values[i].running = 0;
+            if (fd[i] >= 0) {
+                uint64_t v[3];
+                if (read(fd[i], v, sizeof(v)) == sizeof(v)) {
+                    values[i].value = v[0];
+                    values[i].enabled = v[1];
+                    values[i].running = v[2];
+                }
+            }
+        }
+    }
+
+    /**
+     * add counts of one call of a phase.
+     * @param name name of phase
+     * @param sec elapsed seconds
+     * @param start values at the beginning of the phase
+     * @param end values at the end of the phase
+     */
+    void add(const char * name, double sec, const reading start[],
+             const reading end[]) {
+        phase_total * p = find(name);
+        p->calls++;
+        p->sec += sec;
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            p->counts[i] += end[i].value - start[i].value;
+            p->enabled[i] += end[i].enabled - start[i].enabled;
+            p->running[i] += end[i].running - start[i].running;
+        }
+    }
+
+    /**
+     * output totals of phases in the order of the first call.
+     * @param os output stream
+     */
+    void output(std::ostream& os) const {
+        using namespace std;
+        static const char * const names[] = {
+            "cycles", "instructions", "ipc", "l1d-misses", "llc-misses",
+            "branch-misses", "page-faults"};
+        os << "# profile: phase, calls, sec";
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            os << ", " << names[i];
+        }
+        os << endl;
+        for (size_t i = 0; i < phases.size(); i++) {
+            const phase_total& p = phases[i];
+            os << "# profile: " << p.name << ", " << dec << p.calls
+               << ", " << fixed << setprecision(3) << p.sec;
+            for (int j = 0; j < NUM_COUNTERS; j++) {
+                output_count(os, p, j);
+                if (j == INSTRUCTIONS) {
+                    os << ", ";
+                    if (counted(p, CYCLES) && counted(p, INSTRUCTIONS)
+                        && scaled(p, CYCLES) > 0) {
+                        os << fixed << setprecision(2)
+                           << scaled(p, INSTRUCTIONS) / scaled(p, CYCLES);
+                    } else {
+                        os << "-";
+                    }
+                }
+            }
+            os << endl;
+        }
+    }
+private:
+    struct phase_total {
+        std::string name;
+        long calls;
+        double sec;
+        uint64_t counts[NUM_COUNTERS];
+        uint64_t enabled[NUM_COUNTERS];
+        uint64_t running[NUM_COUNTERS];
+    };
+    int fd[NUM_COUNTERS];
+    std::vector<phase_total> phases;
+
+    phase_total * find(const char * name) {
+        for (size_t i = 0; i < phases.size(); i++) {
+            if (phases[i].name == name) {
+                return &phases[i];
+            }
+        }
+        phase_total p;
+        p.name = name;
+        p.calls = 0;
+        p.sec = 0;
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            p.counts[i] = 0;
+            p.enabled[i] = 0;
+            p.running[i] = 0;
+        }
+        phases.push_back(p);
+        return &phases.back();
+    }
+
+    /**
+     * @return true if counter i is supported and ran in the phase
+     */
+    bool counted(const phase_total& p, int i) const {
+        return fd[i] >= 0 && (p.running[i] > 0 || p.enabled[i] == 0);
+    }
+
+    /**
+     * @return count of counter i in the phase, scaled by enabled /
+     * running if the counter was multiplexed
+     */
+    double scaled(const phase_total& p, int i) const {
+        double count = static_cast<double>(p.counts[i]);
+        if (p.running[i] > 0 && p.running[i] < p.enabled[i]) {
+            count = count * p.enabled[i] / p.running[i];
+        }
+        return count;
+    }
+
+    void output_count(std::ostream& os, const phase_total& p, int i) const {
+        if (!counted(p, i)) {
+            os << ", -";
+            return;
+        }
+        os << ", " << std::dec << std::fixed << std::setprecision(0)
+           << scaled(p, i);
+        if (p.running[i] < p.enabled[i]) {
+            os << "*";
+        }
+    }
+
+    void open_counters() {
+#if defined(__linux__)
+        static const uint32_t types[] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE};
+        static const uint64_t configs[] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_SW_PAGE_FAULTS};
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            // threads created in a phase are counted when they exit
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr,
+                                             0, -1, -1, 0));
+        }
+#endif
+    }
+
+    Profile(const Profile&);
+    Profile& operator=(const Profile&);
+};
+
+/**
+ * @class ProfileScope
+ * @brief counts a phase from construction to destruction, also when
+ * the phase ends by an exception.
+ */
+class ProfileScope {
+public:
+    /**
+     * Constructor
+     * @param profile totals, NULL means profiling is disabled
+     * @param name name of phase
+     */
+    ProfileScope(Profile * profile, const char * name) :
+        profile(profile), name(name) {
+        if (profile != 0) {
+            profile->read_counters(start);
+            start_sec = Deadline::now();
+        }
+    }
+
+    ~ProfileScope() {
+        if (profile != 0) {
+            Profile::reading end[Profile::NUM_COUNTERS];
+            double end_sec = Deadline::now();
+            profile->read_counters(end);
+            profile->add(name, end_sec - start_sec, start, end);
+        }
+    }
+private:
+    Profile * profile;
+    const char * name;
+    double start_sec;
+    Profile::reading start[Profile::NUM_COUNTERS];
+    ProfileScope(const ProfileScope&);
+    ProfileScope& operator=(const ProfileScope&);
+};
+
+#endif // PROFILE_HPP
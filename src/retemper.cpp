@@ -0,0 +1,314 @@
+/**
+ * @file retemper.cpp
+ *
+ * @brief search tempering parameters again for parameters which are
+ * already found.
+ *
+ * Recursion search is the most expensive part of the search, and its
+ * result does not depend on tempering. This reads parameter lines,
+ * keeps mexp, id, pos and mat of them, and does only tempering search
+ * and calculation of equidistribution. Entries are processed in
+ * parallel, and outputted in the order of input.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <time.h>
+#include <MTToolBox/AlgorithmEquidistribution.hpp>
+#include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "M4RIEquidistribution.hpp"
+#include "MemoryBudget.hpp"
+#include "ParallelBestBits.hpp"
+#include "TemperingTable.hpp"
+#include "ThreadPool.hpp"
+#include "search.h"
+#include "stattest.h"
+
+using namespace std;
+using namespace MTToolBox;
+
+namespace {
+    struct entry {
+        mt64_param param;
+        string out;
+        string log;
+        bool done;
+    };
+
+    class entry_writer {
+    public:
+        entry_writer(ostream& os, ostream& log, vector<entry>& entries) :
+            os(os), log(log), entries(entries), next(0) {
+        }
+
+        /**
+         * mark entry i as done, and output entries whose previous
+         * entries are all outputted.
+         */
+        void put(size_t i) {
+            unique_lock<mutex> lock(mtx);
+            entries[i].done = true;
+            while (next < entries.size() && entries[next].done) {
+                if (&os != &log) {
+                    log << entries[next].log;
+                    log.flush();
+                }
+                os << entries[next].out;
+                os.flush();
+                next++;
+            }
+        }
+    private:
+        ostream& os;
+        ostream& log;
+        vector<entry>& entries;
+        size_t next;
+        mutex mtx;
+    };
+
+    bool read_entries(const options& opt, ostream& log,
+                      vector<entry>& entries);
+    bool retemper_entry(const options& opt, entry& e, bool combined,
+                        const atomic<bool> * expired);
+}
+
+/**
+ * search tempering parameters of the parameters in the file
+ * opt.retemper_file.
+ * @param opt command line options
+ * @param os output stream of parameters
+ * @param log output stream of logs
+ * @return 0 if this ends normally
+ */
+int retemper(options& opt, ostream& os, ostream& log) {
+    vector<entry> entries;
+    if (!read_entries(opt, log, entries)) {
+        return -1;
+    }
+    ThreadPool pool(opt.threads);
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        log << "#retemper start " << dec << entries.size()
+            << " entries, threads = " << pool.size()
+            << " at " << ctime(&t) << endl;
+    }
+    output_header(os, opt);
+    Deadline deadline(opt.deadline);
+    if (opt.algorithm != "best" && opt.tempering == "auto"
+        && !entries.empty()) {
+        // the first entries are samples of autotune
+        opt.tempering = tempering_table()[0].name();
+        vector<mt64> samples;
+        for (size_t i = 0; i < entries.size()
+                 && samples.size() < AUTOTUNE_SAMPLES; i++) {
+            // seeded as samples of select_tempering(), which come
+            // from RecursionSearch
+            samples.push_back(mt64(entries[i].param));
+            samples.back().seed(1);
+            samples.back().setDeadline(deadline.flag());
+        }
+        try {
+            const tempering_config * tmp
+                = autotune_tempering(log, samples, opt.max_defect,
+                                     opt.resolutions);
+            opt.tempering = tmp->name();
+        } catch (time_limit_error& e) {
+            log << "# autotune: time limit reached, use "
+                << opt.tempering << endl;
+        }
+    }
+    // speeds measured by a worker are disturbed by other workers
+    bool defer = opt.simd_pos > 0 && pool.size() > 1;
+    ostringstream held;
+    ostream& entry_os = defer ? held : os;
+    ostream& entry_log = (defer && &os == &log) ? held : log;
+    opt.defer_speed = defer;
+    entry_writer writer(entry_os, entry_log, entries);
+    atomic<long> found(0);
+    bool combined = &os == &log;
+    for (size_t i = 0; i < entries.size(); i++) {
+        pool.submit([&opt, &entries, &writer, &deadline, &found,
+                     combined, i]() {
+                entry& e = entries[i];
+                if (deadline.isExpired()) {
+                    ostringstream lg;
+                    lg << "# retemper skipped: " << dec << e.param.mexp
+                       << ", " << e.param.id << "; time limit exceeded."
+                       << endl;
+                    (combined ? e.out : e.log) = lg.str();
+                } else if (retemper_entry(opt, e, combined,
+                                          deadline.flag())) {
+                    found++;
+                }
+                writer.put(i);
+            });
+    }
+    pool.wait();
+    if (defer) {
+        opt.defer_speed = false;
+        os << fill_speed(held.str());
+        os.flush();
+    }
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        log << "retemper end " << dec << found << " of " << entries.size()
+            << " at " << ctime(&t) << endl;
+    }
+    return 0;
+}
+
+namespace {
+    /**
+     * read parameter lines. Lines which start with # are skipped.
+     * If mexp is given by the command line, parameters of other mexp
+     * are skipped.
+     */
+    bool read_entries(const options& opt, ostream& log,
+                      vector<entry>& entries) {
+        ifstream ifs(opt.retemper_file.c_str());
+        if (!ifs) {
+            cerr << "can't open file:" << opt.retemper_file << endl;
+            return false;
+        }
+        string line;
+        while (getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            entry e;
+            if (!e.param.parse(line)) {
+                log << "# retemper wrong parameter: " << line << endl;
+                continue;
+            }
+            if (!is_allowed_mexp(e.param.mexp)
+                || (opt.mexp > 0 && e.param.mexp != opt.mexp)) {
+                log << "# retemper skipped mexp: " << line << endl;
+                continue;
+            }
+            // tempering is searched from scratch
+            e.param.tmsk1 = 0;
+            e.param.tmsk2 = 0;
+            e.done = false;
+            entries.push_back(e);
+        }
+        return true;
+    }
+
+    /**
+     * search tempering parameters and calculate equidistribution of
+     * one entry. Outputs are kept in the entry.
+     * @param expired flag of the time limit
+     * @return true if the parameter satisfies the criteria
+     */
+    bool retemper_entry(const options& opt, entry& e, bool combined,
+                        const atomic<bool> * expired) {
+        ostringstream out;
+        ostringstream lg;
+        ostream& log = combined ? out : lg;
+        bool found = false;
+        mt64 g(e.param);
+        // mt64(const mt64_param&) makes the zero state. It is seeded
+        // as RecursionSearch does, because k(v) of the zero state is
+        // meaningless.
+        g.seed(1);
+        g.setDeadline(expired);
+        try {
+            double start = Deadline::now();
+            {
+                MemoryScope memory(opt.memory,
+                                   tempering_footprint(e.param.mexp, 1));
+                if (opt.algorithm == "best") {
+                    ParallelBestBits<mt64> besttmp(2, 15, 1);
+                    g.setTmpIdx(-1);
+                    besttmp(g, false);
+                } else {
+                    const tempering_config * tmp
+                        = find_tempering(opt.tempering);
+                    tmp->stage1(g);
+                    tmp->stage2(g);
+                }
+            }
+            if (opt.verbose) {
+                log << "# tempering time: " << dec << g.getID() << ", "
+                    << fixed << setprecision(3)
+                    << (Deadline::now() - start) << " sec" << endl;
+            }
+            int veq[64];
+            int lsb_veq[64];
+            int delta;
+            int lsb_delta = 0;
+            bool lsb = opt.max_lsb_defect >= 0;
+            {
+                MemoryScope memory(opt.memory,
+                                   equidist_footprint(e.param.mexp,
+                                                      opt.resolutions, lsb));
+                if (lsb) {
+                    delta = get_all_equidist(g, 64, veq, lsb_veq, lsb_delta,
+                                             false, 1, opt.resolutions);
+                } else {
+                    delta = get_all_equidist(g, 64, veq, false, 1,
+                                             opt.resolutions);
+                }
+            }
+            if (delta > opt.max_defect) {
+                log << "# retemper skipped: " << dec << g.getParamString()
+                    << "; dd = " << delta << endl;
+            } else if (opt.max_lsb_defect >= 0
+                       && lsb_delta > opt.max_lsb_defect) {
+                log << "# retemper skipped: " << dec << g.getParamString()
+                    << "; lsb dd = " << lsb_delta << endl;
+            } else {
+                out << g.getParamString();
+                out << "," << dec << delta;
+                if (opt.max_lsb_defect >= 0) {
+                    out << "," << dec << lsb_delta;
+                }
+                if (opt.simd_pos > 0) {
+                    output_speed(out, opt, g.getParam());
+                }
+                if (opt.poly) {
+                    GF2X poly;
+                    const mt64_param& param = g.getParam();
+                    mt64_char_poly(poly, param.mexp, param.pos, param.mat);
+                    out << "," << poly_to_hex(poly);
+                }
+                out << endl;
+                if (opt.stat_tests) {
+                    vector<stat_result> results;
+                    stat_test(results, g.getParam(), opt.seed,
+                              opt.stat_tests);
+                    log << "# stat test: " << dec << g.getID() << "; ";
+                    output_stat_test(log, results);
+                    log << endl;
+                }
+                found = true;
+            }
+        } catch (exception& ex) {
+            log << "# retemper error: " << dec << e.param.mexp << ", "
+                << e.param.id << "; " << ex.what() << endl;
+        }
+        e.out = out.str();
+        e.log = lg.str();
+        return found;
+    }
+}
@@ -25,55 +25,244 @@
 #include <iomanip>
 #include <time.h>
 #include <string>
-//#include <sstream>
+#include <sstream>
 //#include <MTToolBox/AlgorithmRecursionAndTempering.hpp>
 #include <MTToolBox/AlgorithmBestBits.hpp>
-#include <MTToolBox/AlgorithmRecursionSearch.hpp>
 #include <MTToolBox/AlgorithmEquidistribution.hpp>
-#include <MTToolBox/AlgorithmPartialBitPattern.hpp>
 //#include <MTToolBox/MersenneTwister.hpp>
 #include "MixedSequence.hpp"
+#include "SplitSequence.hpp"
 //#include <NTL/GF2X.h>
 //#include "options.hpp"
 #include "mt64Search.hpp"
+#include "mt64CharPoly.hpp"
+#include "RecursionSearch.hpp"
+#include "mt64Runtime.hpp"
+#include "M4RIEquidistribution.hpp"
+#include "profile.hpp"
+#include "CoverageMap.hpp"
+#include "MemoryBudget.hpp"
+#include "TemperingTable.hpp"
 #include "search.h"
+#include "stattest.h"
 
 using namespace std;
 using namespace MTToolBox;
 using namespace NTL;
 
+/**
+ * output header line of parameters.
+ * @param os output stream of parameters
+ * @param opt command line options
+ */
+void output_header(ostream& os, const options& opt) {
+    mt64_param param;
+    os << "# " << param.get_header() << ", delta";
+    if (opt.max_lsb_defect >= 0) {
+        os << ", lsb_delta";
+    }
+    if (opt.simd_pos > 0) {
+        os << ", speed";
+    }
+    if (opt.poly) {
+        os << ", poly";
+    }
+    os << endl;
+}
+
+/**
+ * replace opt.tempering auto by the tempering configuration selected
+ * by autotune_tempering(). Sample recursions are searched by another
+ * sequence than the search, so they are not lost. If the time limit
+ * is reached or the sequence is exhausted before samples are found,
+ * the default configuration is used.
+ * @param opt command line options
+ * @param log output stream of logs
+ */
+void select_tempering(options& opt, ostream& log) {
+    if (opt.tempering != "auto") {
+        return;
+    }
+    opt.tempering = tempering_table()[0].name();
+    uint32_t seq = ~static_cast<uint32_t>(0);
+    if (opt.seq > 0) {
+        seq = opt.seq;
+    }
+    MixedSequence mx(seq, opt.seed ^ UINT64_C(0x9e3779b97f4a7c15), 0);
+    mt64 g(opt.mexp, opt.id >= 0 ? opt.id : 0);
+    if (opt.fixedPOS > 0) {
+        g.setFixedPOS(opt.fixedPOS);
+    }
+    if (opt.simd_pos > 0) {
+        g.setSimdPos(opt.simd_pos);
+    }
+    Deadline deadline(opt.deadline);
+    g.setDeadline(deadline.flag());
+    RecursionSearch<mt64> rs(g, mx);
+    rs.setAlgebraic(opt.charpoly == "algebraic");
+    vector<mt64> samples;
+    try {
+        while (samples.size() < AUTOTUNE_SAMPLES) {
+            if (rs.start(opt.logcount)) {
+                samples.push_back(g);
+            }
+        }
+        const tempering_config * tmp
+            = autotune_tempering(log, samples, opt.max_defect,
+                                 opt.resolutions);
+        opt.tempering = tmp->name();
+    } catch (time_limit_error& e) {
+        log << "# autotune: time limit reached, use "
+            << opt.tempering << endl;
+    } catch (underflow_error& e) {
+        log << "# autotune: sequence has wasted out, use "
+            << opt.tempering << endl;
+    }
+}
+
 namespace {
-    int search_main(options& opt, ostream& os, ostream& log, int count);
+    int search_main(options& opt, ostream& os, ostream& log, int count,
+                    bool header, long& cnt, Profile * profile,
+                    CoverageMap * coverage);
 }
 
 /**
  * search parameters using all_in_one function in the file search_all.hpp
  * @param opt command line options
  * @param count number of parameters user requested
+ * @param header output header line or not
  * @return 0 if this ends normally
  */
-int search(options& opt, ostream& os, ostream& log, int count) {
+int search(options& opt, ostream& os, ostream& log, int count, bool header) {
+    long cnt = 0;
+    const char * status = "complete";
+    Profile prof(opt.profile);
+    CoverageMap cov(opt.coverage_file);
+    CoverageMap * coverage = opt.coverage;
+    if (coverage == 0 && !opt.coverage_file.empty()) {
+        if (cov.load()) {
+            coverage = &cov;
+        } else {
+            log << "# coverage: can't read " << opt.coverage_file << endl;
+        }
+    }
     try {
-        return search_main(opt, os, log, count);
+        search_main(opt, os, log, count, header, cnt,
+                    opt.profile ? &prof : 0,
+                    coverage);
     } catch (underflow_error &e) {
         log << "# search end: sequence has wasted out." << endl;
-        return 0;
+        status = "exhausted";
+    } catch (time_limit_error &e) {
+        log << "# search end: time limit exceeded." << endl;
+        status = "time-limit";
+    }
+    if (opt.time_limit > 0) {
+        output_status(os, opt, cnt, count, status);
+    }
+    if (coverage != 0 && !coverage->save()) {
+        log << "# coverage: can't write " << opt.coverage_file << endl;
+    }
+    if (opt.profile) {
+        prof.output(log);
     }
+    return 0;
 }
 
-namespace {
-    int search_main(options& opt, ostream& os, ostream& log, int count) {
-        typedef AlgorithmPartialBitPattern<uint64_t, 64, 1, 47, 5> stsl1;
-        typedef AlgorithmPartialBitPattern<uint64_t, 64, 1, 27, 5> stsl2;
+/**
+ * output status line of a search with time limit.
+ * @param os output stream of parameters
+ * @param opt command line options
+ * @param found number of parameters outputted
+ * @param count number of parameters requested
+ * @param status complete, exhausted or time-limit
+ */
+void output_status(ostream& os, const options& opt, long found, long count,
+                   const char * status) {
+    os << "# status: " << status
+       << ", id = " << dec << opt.id
+       << ", found = " << found
+       << ", count = " << count
+       << ", target " << (found >= count ? "met" : "not met") << endl;
+}
 
-        stsl1 apbp1;
-        stsl2 apbp2;
+/**
+ * @param opt command line options
+ * @param seq seq of the first candidate
+ * @return stream of candidates of the search, which identifies
+ * candidates in the coverage file when pos is not fixed
+ */
+CoverageMap::stream coverage_stream(const options& opt, uint32_t seq) {
+    if (opt.fixedPOS > 0) {
+        return CoverageMap::stream();
+    }
+    int generator = opt.part_count > 0 ? CoverageMap::SPLIT
+        : CoverageMap::MIXED;
+    return CoverageMap::stream(generator, opt.seed, seq, opt.simd_pos);
+}
+
+/**
+ * output speed column of a parameter line. When opt.defer_speed is
+ * set, "-" is outputted, and fill_speed() measures it later.
+ * @param os output stream of parameters
+ * @param opt command line options
+ * @param param found parameter
+ */
+void output_speed(ostream& os, const options& opt, const mt64_param& param) {
+    if (opt.defer_speed) {
+        os << ",-";
+    } else {
+        os << "," << fixed << setprecision(1) << mt64_speed(param);
+    }
+}
+
+/**
+ * measure speeds of parameter lines outputted with opt.defer_speed.
+ * Worker threads of id-range search, campaign and retemper do not
+ * measure speeds, because other workers disturb the measurement. They
+ * are measured by this function after the workers end.
+ * @param lines parameter lines, lines of logs may be mixed
+ * @return lines whose speed column "-" is replaced by the speed
+ */
+string fill_speed(const string& lines) {
+    istringstream is(lines);
+    ostringstream os;
+    string line;
+    while (getline(is, line)) {
+        mt64_param param;
+        if (line.empty() || line[0] == '#' || !param.parse(line)) {
+            os << line << endl;
+            continue;
+        }
+        string::size_type p = line.find(",-", 0);
+        if (p == string::npos) {
+            os << line << endl;
+            continue;
+        }
+        os << line.substr(0, p) << "," << fixed << setprecision(1)
+           << mt64_speed(param) << line.substr(p + 2) << endl;
+    }
+    return os.str();
+}
+
+namespace {
+    int search_main(options& opt, ostream& os, ostream& log, int count,
+                    bool header, long& cnt, Profile * profile,
+                    CoverageMap * coverage) {
+        select_tempering(opt, log);
+        const tempering_config * tmp = find_tempering(opt.tempering);
         uint32_t seq = 0;
         seq = ~seq;
         if (opt.seq > 0) {
             seq = opt.seq;
         }
         MixedSequence mx(seq, opt.seed, 0);
+        SplitSequence sp(seq, opt.seed);
+        ParameterGenerator * pg = &mx;
+        if (opt.part_count > 0) {
+            sp.partition(opt.part_index, opt.part_count);
+            pg = &sp;
+        }
         mt64 g(opt.mexp, opt.id);
         //static const int shifts[] = {17, 37};
         // limit_v 何ビットテンパリングするか とりあえず 15のまま
@@ -82,36 +271,132 @@ namespace {
             time_t t = time(NULL);
             log << "#search start id = " << opt.id << " at " << ctime(&t) << endl;
             log << "#seed = " << dec << opt.seed
-                << ", seq = " << seq << endl;
+                << ", seq = " << seq
+                << ", tempering = " << tmp->name() << endl;
+            if (opt.part_count > 0) {
+                log << "#partition = " << opt.part_index << "/"
+                    << opt.part_count << ", candidates = ["
+                    << sp.getBegin() << ", " << sp.getEnd() << ")" << endl;
+            }
         }
         if (opt.fixedPOS > 0) {
             g.setFixedPOS(opt.fixedPOS);
         }
+        if (opt.simd_pos > 0) {
+            g.setSimdPos(opt.simd_pos);
+        }
+        Deadline deadline(opt.deadline);
+        g.setDeadline(deadline.flag());
 
-        AlgorithmRecursionSearch<uint64_t> ars(g, mx);
-        long cnt = 0;
-        os << "# " << g.getHeaderString() << ", delta"
-           << endl;
+        RecursionSearch<mt64> ars(g, *pg);
+        ars.setAlgebraic(opt.charpoly == "algebraic");
+        ars.setCoverage(coverage, coverage_stream(opt, seq));
+        cnt = 0;
+        if (header) {
+            output_header(os, opt);
+        }
         while (cnt < count) {
-            if (ars.start(opt.logcount)) {
+            long before = ars.getCount();
+            long skipped = ars.getSkipped();
+            double start = Deadline::now();
+            bool found;
+            {
+                MemoryScope memory(opt.memory,
+                                   recursion_footprint(opt.mexp));
+                ProfileScope scope(profile, "recursion");
+                found = ars.start(opt.logcount);
+            }
+            if (opt.verbose) {
+                log << "# recursion search: " << dec
+                    << (ars.getCount() - before) << " candidates, "
+                    << fixed << setprecision(3)
+                    << (Deadline::now() - start) << " sec" << endl;
+                if (coverage != 0) {
+                    log << "# coverage: " << dec
+                        << (ars.getSkipped() - skipped)
+                        << " candidates skipped, "
+                        << coverage->intervals() << " intervals" << endl;
+                }
+            }
+            if (coverage != 0 && !coverage->save()) {
+                log << "# coverage: can't write " << opt.coverage_file
+                    << endl;
+            }
+            if (found) {
                 log << "# search found: " << dec << g.getID()
                     << ", " << g.getSEQ()
                     << "; tempering search start..." << endl;
-                g.setTmpIdx(0);
-                apbp1(g, false);
-                g.setTmpIdx(1);
-                apbp2(g, false);
-                AlgorithmEquidistribution<uint64_t> equi(g, 64, opt.mexp);
+                start = Deadline::now();
+                {
+                    MemoryScope memory(opt.memory,
+                                       tempering_footprint(opt.mexp, 1));
+                    {
+                        ProfileScope scope(profile, "tempering1");
+                        tmp->stage1(g);
+                    }
+                    {
+                        ProfileScope scope(profile, "tempering2");
+                        tmp->stage2(g);
+                    }
+                }
+                if (opt.verbose) {
+                    log << "# tempering time: " << fixed << setprecision(3)
+                        << (Deadline::now() - start) << " sec" << endl;
+                }
                 int veq[64];
-                int delta = equi.get_all_equidist(veq);
+                int lsb_veq[64];
+                int delta;
+                int lsb_delta = 0;
+                bool lsb = opt.max_lsb_defect >= 0;
+                {
+                    MemoryScope memory(opt.memory,
+                                       equidist_footprint(opt.mexp,
+                                                          opt.resolutions,
+                                                          lsb));
+                    ProfileScope scope(profile, "equidistribution");
+                    if (lsb) {
+                        delta = get_all_equidist(g, 64, veq, lsb_veq,
+                                                 lsb_delta, false, 1,
+                                                 opt.resolutions);
+                    } else {
+                        delta = get_all_equidist(g, 64, veq, false, 1,
+                                                 opt.resolutions);
+                    }
+                }
                 if (delta > opt.max_defect) {
                     log << "# search skipped: " << dec << g.getID()
                         << ", " << g.getSEQ()
                         << "; dd = " << delta << endl;
                     continue;
                 }
+                if (opt.max_lsb_defect >= 0
+                    && lsb_delta > opt.max_lsb_defect) {
+                    log << "# search skipped: " << dec << g.getID()
+                        << ", " << g.getSEQ()
+                        << "; lsb dd = " << lsb_delta << endl;
+                    continue;
+                }
                 os << g.getParamString();
-                os << "," << dec << delta << endl;
+                os << "," << dec << delta;
+                if (opt.max_lsb_defect >= 0) {
+                    os << "," << dec << lsb_delta;
+                }
+                if (opt.simd_pos > 0) {
+                    output_speed(os, opt, g.getParam());
+                }
+                if (opt.poly) {
+                    os << "," << poly_to_hex(ars.getMinPoly());
+                }
+                os << endl;
+                if (opt.stat_tests) {
+                    vector<stat_result> results;
+                    stat_test(results, g.getParam(), opt.seed,
+                              opt.stat_tests);
+                    log << "# stat test: " << dec << g.getID()
+                        << ", " << g.getSEQ() << "; ";
+                    output_stat_test(log, results);
+                    log << endl;
+                }
 #if defined(DEBUG)
                 for (int j = 0; j < 64; j++) {
                     cout << "k(" << dec << (j + 1) << ") = " << dec << veq[j];
@@ -3,10 +3,34 @@
 #define SEARCH_H
 
 #include <iostream>
+#include <string>
 
 #include "options.h"
+#include "CoverageMap.hpp"
 
-int search(options& opt, std::ostream& os, std::ostream& log, int count);
-int best_search(options& opt, std::ostream& os, std::ostream& log, int count);
+namespace MTToolBox {
+    class mt64_param;
+}
+
+typedef int (*search_func)(options& opt, std::ostream& os, std::ostream& log,
+                           int count, bool header);
+
+int search(options& opt, std::ostream& os, std::ostream& log, int count,
+           bool header = true);
+int best_search(options& opt, std::ostream& os, std::ostream& log, int count,
+                bool header = true);
+void output_header(std::ostream& os, const options& opt);
+void output_status(std::ostream& os, const options& opt, long found,
+                   long count, const char * status);
+void output_speed(std::ostream& os, const options& opt,
+                  const MTToolBox::mt64_param& param);
+std::string fill_speed(const std::string& lines);
+CoverageMap::stream coverage_stream(const options& opt, uint32_t seq);
+int search_range(options& opt, std::ostream& os, std::ostream& log, int count,
+                 search_func func, bool header = true);
+int retemper(options& opt, std::ostream& os, std::ostream& log);
+int campaign(options& opt, std::ostream& os, std::ostream& log,
+             search_func func);
+void select_tempering(options& opt, std::ostream& log);
 
 #endif // SEARCH_H
@@ -0,0 +1,610 @@
+/**
+ * @file search_bench.cpp
+ *
+ * @brief reproducible benchmark of the whole search, search() and
+ * best_search(), for each mersenne exponent.
+ *
+ * Seed, id and start seq are fixed, so found parameters are always the
+ * same. For each algorithm and mexp, time to the first parameter,
+ * total time, parameters per hour and the time of each phase are
+ * outputted. Found parameters are compared with a golden file, and
+ * times are compared with a baseline file, a run slower than the
+ * baseline by more than the tolerance is reported as a regression.
+ * Both files are written by --record.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <map>
+#include "deadline.hpp"
+#include "options.h"
+#include "search.h"
+
+using namespace std;
+
+class bench_options {
+public:
+    vector<int> mexps;
+    vector<string> algorithms;
+    long count;
+    int64_t id;
+    long seq;
+    uint64_t seed;
+    int threads;
+    string golden;
+    string baseline;
+    bool record;
+    double tolerance;           // percent
+};
+
+namespace {
+    /**
+     * @class timed_buffer
+     * @brief stream buffer which keeps outputs and the time when each
+     * parameter line, which does not start with #, is completed.
+     */
+    class timed_buffer : public streambuf {
+    public:
+        timed_buffer() {
+            line_start = 0;
+        }
+        const string& str() const {
+            return buf;
+        }
+        const vector<double>& times() const {
+            return line_times;
+        }
+    protected:
+        int overflow(int c) {
+            if (c != traits_type::eof()) {
+                char ch = static_cast<char>(c);
+                append(&ch, 1);
+            }
+            return c;
+        }
+
+        streamsize xsputn(const char * s, streamsize n) {
+            append(s, n);
+            return n;
+        }
+    private:
+        string buf;
+        size_t line_start;
+        vector<double> line_times;
+
+        void append(const char * s, streamsize n) {
+            size_t pos = buf.size();
+            buf.append(s, n);
+            for (; pos < buf.size(); pos++) {
+                if (buf[pos] != '\n') {
+                    continue;
+                }
+                if (pos > line_start && buf[line_start] != '#') {
+                    line_times.push_back(Deadline::now());
+                }
+                line_start = pos + 1;
+            }
+        }
+    };
+
+    struct bench_result {
+        long count;
+        double first_sec;
+        double total_sec;
+    };
+
+    typedef map<string, bench_result> result_map;
+    typedef map<string, vector<string> > golden_map;
+
+    bool parse_opt(bench_options& opt, int argc, char **argv);
+    void output_help(string& pgm);
+    bench_result bench(const bench_options& opt, const string& algorithm,
+                       int mexp, vector<string>& params,
+                       vector<string>& phases);
+    bool read_golden(const string& filename, golden_map& golden);
+    bool read_baseline(const string& filename, result_map& baseline);
+    bool check_golden(ostream& os, const string& key,
+                      const vector<string>& params,
+                      const golden_map& golden);
+    bool check_baseline(ostream& os, const string& key,
+                        const bench_result& result,
+                        const result_map& baseline, double tolerance);
+    double per_hour(const bench_result& result);
+}
+
+int main(int argc, char * argv[])
+{
+    bench_options opt;
+    if (!parse_opt(opt, argc, argv)) {
+        return -1;
+    }
+    golden_map golden;
+    result_map baseline;
+    if (!opt.record) {
+        if (!opt.golden.empty() && !read_golden(opt.golden, golden)) {
+            cerr << "can't read golden file:" << opt.golden << endl;
+            return -1;
+        }
+        if (!opt.baseline.empty()
+            && !read_baseline(opt.baseline, baseline)) {
+            cerr << "can't read baseline file:" << opt.baseline << endl;
+            return -1;
+        }
+    }
+    ofstream golden_out;
+    ofstream baseline_out;
+    if (opt.record) {
+        if (!opt.golden.empty()) {
+            golden_out.open(opt.golden.c_str());
+            if (!golden_out) {
+                cerr << "can't open file:" << opt.golden << endl;
+                return -1;
+            }
+            golden_out << "# algorithm, mexp, parameter" << endl;
+        }
+        if (!opt.baseline.empty()) {
+            baseline_out.open(opt.baseline.c_str());
+            if (!baseline_out) {
+                cerr << "can't open file:" << opt.baseline << endl;
+                return -1;
+            }
+            baseline_out << "# algorithm, mexp, count, first sec, total sec"
+                         << endl;
+        }
+    }
+    cout << "# seed = " << dec << opt.seed << ", id = " << opt.id
+         << ", seq = ";
+    if (opt.seq > 0) {
+        cout << opt.seq;
+    } else {
+        cout << "all";
+    }
+    cout << ", count = " << opt.count
+         << ", threads = " << opt.threads << endl;
+    cout << "# algorithm, mexp, count, first sec, total sec, params/hour"
+         << endl;
+    bool ok = true;
+    for (size_t i = 0; i < opt.algorithms.size(); i++) {
+        for (size_t j = 0; j < opt.mexps.size(); j++) {
+            const string& algorithm = opt.algorithms[i];
+            int mexp = opt.mexps[j];
+            ostringstream ss;
+            ss << algorithm << "," << dec << mexp;
+            string key = ss.str();
+            vector<string> params;
+            vector<string> phases;
+            bench_result result = bench(opt, algorithm, mexp, params,
+                                        phases);
+            cout << algorithm << ", " << dec << mexp << ", "
+                 << result.count << ", " << fixed << setprecision(3)
+                 << result.first_sec << ", " << result.total_sec << ", "
+                 << setprecision(1) << per_hour(result) << endl;
+            for (size_t k = 0; k < phases.size(); k++) {
+                cout << "#  " << phases[k] << endl;
+            }
+            if (result.count < opt.count) {
+                cout << "# " << key << ": found only " << dec
+                     << result.count << " parameters" << endl;
+                ok = false;
+            }
+            if (opt.record) {
+                for (size_t k = 0; k < params.size(); k++) {
+                    golden_out << key << "," << params[k] << endl;
+                }
+                baseline_out << key << "," << dec << result.count << ","
+                             << fixed << setprecision(6)
+                             << result.first_sec << ","
+                             << result.total_sec << endl;
+                continue;
+            }
+            if (!opt.golden.empty()) {
+                ok = check_golden(cout, key, params, golden) && ok;
+            }
+            if (!opt.baseline.empty()) {
+                ok = check_baseline(cout, key, result, baseline,
+                                    opt.tolerance) && ok;
+            }
+        }
+    }
+    if (!opt.record && (!opt.golden.empty() || !opt.baseline.empty())) {
+        cout << "# result: " << (ok ? "pass" : "fail") << endl;
+    }
+    return ok ? 0 : -1;
+}
+
+namespace {
+    /**
+     * run one search with fixed options.
+     * @param bopt benchmark options
+     * @param algorithm partial or best
+     * @param mexp mersenne exponent
+     * @param params found parameter lines
+     * @param phases profile lines of phases
+     * @return times of the search
+     */
+    bench_result bench(const bench_options& bopt, const string& algorithm,
+                       int mexp, vector<string>& params,
+                       vector<string>& phases) {
+        options opt;
+        init_opt(opt);
+        opt.mexp = mexp;
+        opt.id = bopt.id;
+        opt.seq = bopt.seq;
+        opt.seed = bopt.seed;
+        opt.threads = bopt.threads;
+        opt.algorithm = algorithm;
+        opt.logcount = opt.mexp / 2;
+        opt.max_defect = opt.mexp * 64;
+        opt.profile = true;
+        search_func func = search;
+        if (algorithm == "best") {
+            func = best_search;
+        }
+        timed_buffer buf;
+        ostream os(&buf);
+        ostringstream log;
+        double start = Deadline::now();
+        func(opt, os, log, static_cast<int>(bopt.count), false);
+        bench_result result;
+        result.total_sec = Deadline::now() - start;
+        result.count = static_cast<long>(buf.times().size());
+        result.first_sec = result.total_sec;
+        if (!buf.times().empty()) {
+            result.first_sec = buf.times()[0] - start;
+        }
+        string line;
+        istringstream is(buf.str());
+        while (getline(is, line)) {
+            if (!line.empty() && line[0] != '#') {
+                params.push_back(line);
+            }
+        }
+        istringstream ls(log.str());
+        while (getline(ls, line)) {
+            if (line.compare(0, 11, "# profile: ") == 0) {
+                phases.push_back(line.substr(2));
+            }
+        }
+        return result;
+    }
+
+    double per_hour(const bench_result& result) {
+        if (result.total_sec <= 0) {
+            return 0;
+        }
+        return result.count / result.total_sec * 3600;
+    }
+
+    /**
+     * read golden file, lines of algorithm,mexp,parameter.
+     */
+    bool read_golden(const string& filename, golden_map& golden) {
+        ifstream ifs(filename.c_str());
+        if (!ifs) {
+            return false;
+        }
+        string line;
+        while (getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            size_t p = line.find(',');
+            if (p != string::npos) {
+                p = line.find(',', p + 1);
+            }
+            if (p == string::npos) {
+                continue;
+            }
+            golden[line.substr(0, p)].push_back(line.substr(p + 1));
+        }
+        return true;
+    }
+
+    /**
+     * read baseline file, lines of algorithm,mexp,count,first,total.
+     */
+    bool read_baseline(const string& filename, result_map& baseline) {
+        ifstream ifs(filename.c_str());
+        if (!ifs) {
+            return false;
+        }
+        string line;
+        while (getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            vector<string> fields;
+            istringstream ss(line);
+            string field;
+            while (getline(ss, field, ',')) {
+                fields.push_back(field);
+            }
+            if (fields.size() < 5) {
+                continue;
+            }
+            bench_result& r = baseline[fields[0] + "," + fields[1]];
+            r.count = strtol(fields[2].c_str(), NULL, 10);
+            r.first_sec = strtod(fields[3].c_str(), NULL);
+            r.total_sec = strtod(fields[4].c_str(), NULL);
+        }
+        return true;
+    }
+
+    /**
+     * @return true if found parameters are same as golden parameters
+     */
+    bool check_golden(ostream& os, const string& key,
+                      const vector<string>& params,
+                      const golden_map& golden) {
+        golden_map::const_iterator it = golden.find(key);
+        if (it == golden.end()) {
+            os << "# " << key << ": golden: not recorded" << endl;
+            return true;
+        }
+        const vector<string>& expected = it->second;
+        for (size_t i = 0; i < params.size() || i < expected.size(); i++) {
+            if (i >= params.size() || i >= expected.size()
+                || params[i] != expected[i]) {
+                os << "# " << key << ": golden: mismatch at " << dec << i
+                   << endl;
+                if (i < expected.size()) {
+                    os << "#  expected: " << expected[i] << endl;
+                }
+                if (i < params.size()) {
+                    os << "#  found:    " << params[i] << endl;
+                }
+                return false;
+            }
+        }
+        os << "# " << key << ": golden: ok" << endl;
+        return true;
+    }
+
+    /**
+     * @return true if times are not slower than baseline more than
+     * tolerance
+     */
+    bool check_baseline(ostream& os, const string& key,
+                        const bench_result& result,
+                        const result_map& baseline, double tolerance) {
+        result_map::const_iterator it = baseline.find(key);
+        if (it == baseline.end()) {
+            os << "# " << key << ": baseline: not recorded" << endl;
+            return true;
+        }
+        const bench_result& base = it->second;
+        bool ok = true;
+        const char * names[] = {"first", "total"};
+        double times[] = {result.first_sec, result.total_sec};
+        double base_times[] = {base.first_sec, base.total_sec};
+        os << "# " << key << ": baseline:";
+        for (int i = 0; i < 2; i++) {
+            double change = 0;
+            if (base_times[i] > 0) {
+                change = (times[i] / base_times[i] - 1) * 100;
+            }
+            os << " " << names[i] << " " << showpos << fixed
+               << setprecision(1) << change << noshowpos << "%";
+            if (change > tolerance) {
+                ok = false;
+            }
+        }
+        os << (ok ? " ok" : " regression") << endl;
+        return ok;
+    }
+
+    /**
+     * parse comma separated list of mexp.
+     */
+    bool parse_mexps(vector<int>& mexps, const char * str) {
+        mexps.clear();
+        const char * p = str;
+        for (;;) {
+            char * end;
+            errno = 0;
+            long mexp = strtol(p, &end, 10);
+            if (errno || end == p || !is_allowed_mexp(mexp)) {
+                return false;
+            }
+            mexps.push_back(static_cast<int>(mexp));
+            if (*end == '\0') {
+                return true;
+            }
+            if (*end != ',') {
+                return false;
+            }
+            p = end + 1;
+        }
+    }
+
+    /**
+     * command line option parser
+     * @param opt a structure to keep the result of parsing
+     * @param argc number of command line arguments
+     * @param argv command line arguments
+     * @return command line options have error, or not
+     */
+    bool parse_opt(bench_options& opt, int argc, char **argv) {
+        opt.count = 2;
+        opt.id = 0;
+        opt.seq = 0;
+        opt.seed = 1234;
+        opt.threads = 1;
+        opt.record = false;
+        opt.tolerance = 10;
+        string algorithm = "all";
+        int c;
+        bool error = false;
+        string pgm = argv[0];
+        static struct option longopts[] = {
+            {"mexp", required_argument, NULL, 'm'},
+            {"algorithm", required_argument, NULL, 'A'},
+            {"count", required_argument, NULL, 'c'},
+            {"id", required_argument, NULL, 'I'},
+            {"start-seq", required_argument, NULL, 'S'},
+            {"seed", required_argument, NULL, 's'},
+            {"threads", required_argument, NULL, 't'},
+            {"golden", required_argument, NULL, 'g'},
+            {"baseline", required_argument, NULL, 'b'},
+            {"record", no_argument, NULL, 'r'},
+            {"tolerance", required_argument, NULL, 'T'},
+            {NULL, 0, NULL, 0}};
+        errno = 0;
+        for (;;) {
+            c = getopt_long(argc, argv, "m:A:c:I:S:s:t:g:b:rT:", longopts,
+                            NULL);
+            if (error) {
+                break;
+            }
+            if (c == -1) {
+                break;
+            }
+            switch (c) {
+            case 'm':
+                if (!parse_mexps(opt.mexps, optarg)) {
+                    error = true;
+                    cerr << "mexp is not supported" << endl;
+                }
+                break;
+            case 'A':
+                algorithm = optarg;
+                if (algorithm != "partial" && algorithm != "best"
+                    && algorithm != "all") {
+                    error = true;
+                    cerr << "algorithm must be partial, best or all" << endl;
+                }
+                break;
+            case 'c':
+                opt.count = strtol(optarg, NULL, 10);
+                if (errno || opt.count <= 0) {
+                    error = true;
+                    cerr << "count must be a positive number" << endl;
+                }
+                break;
+            case 'I':
+                opt.id = strtoll(optarg, NULL, 10);
+                if (errno || opt.id < 0) {
+                    error = true;
+                    cerr << "id must be a number" << endl;
+                }
+                break;
+            case 'S':
+                opt.seq = strtol(optarg, NULL, 10);
+                if (errno || opt.seq <= 0) {
+                    error = true;
+                    cerr << "start seq must be a positive number" << endl;
+                }
+                break;
+            case 's':
+                opt.seed = strtoull(optarg, NULL, 0);
+                if (errno) {
+                    error = true;
+                    cerr << "seed must be a number" << endl;
+                }
+                break;
+            case 't':
+                opt.threads = strtol(optarg, NULL, 10);
+                if (errno || opt.threads < 0) {
+                    error = true;
+                    cerr << "threads must be a number" << endl;
+                }
+                break;
+            case 'g':
+                opt.golden = optarg;
+                break;
+            case 'b':
+                opt.baseline = optarg;
+                break;
+            case 'r':
+                opt.record = true;
+                break;
+            case 'T':
+                opt.tolerance = strtod(optarg, NULL);
+                if (errno || opt.tolerance < 0) {
+                    error = true;
+                    cerr << "tolerance must be a non negative number" << endl;
+                }
+                break;
+            case '?':
+            default:
+                error = true;
+                break;
+            }
+        }
+        if (!error && opt.record && opt.golden.empty()
+            && opt.baseline.empty()) {
+            error = true;
+            cerr << "record needs golden or baseline file" << endl;
+        }
+        if (error) {
+            output_help(pgm);
+            return false;
+        }
+        if (opt.mexps.empty()) {
+            for (int i = 0; allowed_mexp[i] > 0; i++) {
+                opt.mexps.push_back(allowed_mexp[i]);
+            }
+        }
+        if (algorithm == "all" || algorithm == "partial") {
+            opt.algorithms.push_back("partial");
+        }
+        if (algorithm == "all" || algorithm == "best") {
+            opt.algorithms.push_back("best");
+        }
+        return true;
+    }
+
+    /**
+     * showing help message
+     * @param pgm program name
+     */
+    void output_help(string& pgm)
+    {
+        cerr << "usage:" << endl;
+        cerr << pgm << " [-m mexp,...] [-A algorithm] [-c count] [-I id]"
+             << " [-S start_seq] [-s seed] [-t threads]"
+             << " [-g golden] [-b baseline] [-r] [-T tolerance]" << endl;
+        static string help_string1 = "\n"
+            "--mexp, -m mexp,...  comma separated mersenne exponents.\n"
+            "                     default is all supported exponents.\n"
+            "--algorithm, -A alg  partial, best or all. default is all.\n"
+            "--count, -c count    number of parameters of each mexp.\n"
+            "                     default is 2.\n"
+            "--id, -I id          id of parameters. default is 0.\n"
+            "--start-seq, -S seq  start seq of candidates. default is all the\n"
+            "                     seq space, the fixed seed makes runs\n"
+            "                     reproducible.\n"
+            "--seed, -s seed      seed of candidates. default is 1234.\n"
+            "--threads, -t num    number of threads. default is 1, which\n"
+            "                     gives the most stable times.\n"
+            "--golden, -g file    parameters found must be same as the\n"
+            "                     parameters in this file.\n"
+            "--baseline, -b file  times must not be slower than the times\n"
+            "                     in this file by more than tolerance.\n"
+            "--record, -r         write found parameters and times to golden\n"
+            "                     file and baseline file, instead of checking.\n"
+            "--tolerance, -T pct  allowed slowdown in percent. default is 10.\n"
+            ;
+        cerr << help_string1 << endl;
+    }
+}
@@ -0,0 +1,196 @@
+/**
+ * @file search_range.cpp
+ *
+ * @brief search parameters for a range of ids in one process.
+ *
+ * Each id is searched by the given search function with its own
+ * generator and sequence, and the ids are scheduled on worker
+ * threads. The generator and the recursion search depend on the id
+ * and cost little to make, so only the coverage map, which is read
+ * from a file, is shared by the ids. Outputs of ids are buffered and flushed to one stream in
+ * the order of id, so that the output does not depend on the number
+ * of threads. When speeds are measured by several threads, outputs
+ * are kept until all ids end and speeds are measured at the end.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <time.h>
+#include "ThreadPool.hpp"
+#include "mt64Search.hpp"
+#include "search.h"
+#include "CoverageMap.hpp"
+
+using namespace std;
+using namespace MTToolBox;
+
+namespace {
+    struct id_result {
+        string out;
+        string log;
+        int rc;
+    };
+
+    class range_writer {
+    public:
+        range_writer(ostream& os, ostream& log, int64_t first) :
+            os(os), log(log), next(first) {
+        }
+
+        /**
+         * @return true if parameters and logs go to the same stream
+         */
+        bool combined() const {
+            return &os == &log;
+        }
+
+        /**
+         * keep the result of id, and output results of ids whose
+         * previous ids are all outputted.
+         */
+        void put(int64_t id, const id_result& result) {
+            unique_lock<mutex> lock(mtx);
+            pending[id] = result;
+            for (;;) {
+                map<int64_t, id_result>::iterator it = pending.find(next);
+                if (it == pending.end()) {
+                    break;
+                }
+                if (!combined()) {
+                    log << it->second.log;
+                    log.flush();
+                }
+                os << it->second.out;
+                os.flush();
+                pending.erase(it);
+                next++;
+            }
+        }
+    private:
+        ostream& os;
+        ostream& log;
+        int64_t next;
+        mutex mtx;
+        map<int64_t, id_result> pending;
+    };
+
+    void search_ids(const options& opt, int count, search_func func,
+                    atomic<int64_t>& next_id, atomic<int>& rc,
+                    range_writer& writer);
+}
+
+/**
+ * search parameters for ids from opt.id to opt.last_id.
+ * @param opt command line options
+ * @param os output stream of parameters
+ * @param log output stream of logs
+ * @param count number of parameters requested for each id
+ * @param func search function applied to each id
+ * @param header output header line or not
+ * @return 0 if all searches end normally
+ */
+int search_range(options& opt, ostream& os, ostream& log, int count,
+                 search_func func, bool header) {
+    ThreadPool pool(opt.threads);
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        log << "#range search start id = " << dec << opt.id
+            << " to " << opt.last_id
+            << " threads = " << pool.size()
+            << " at " << ctime(&t) << endl;
+    }
+    if (header) {
+        output_header(os, opt);
+    }
+    if (func == search) {
+        // autotune once for all ids
+        select_tempering(opt, log);
+    }
+    // read the coverage file once for all ids. If it can't be read,
+    // each id reports it.
+    CoverageMap cov(opt.coverage_file);
+    CoverageMap * saved_coverage = opt.coverage;
+    if (opt.coverage == 0 && !opt.coverage_file.empty() && cov.load()) {
+        opt.coverage = &cov;
+    }
+    // speeds measured by a worker are disturbed by other workers
+    bool defer = opt.simd_pos > 0 && pool.size() > 1;
+    ostringstream held;
+    ostream& range_os = defer ? held : os;
+    ostream& range_log = (defer && &os == &log) ? held : log;
+    opt.defer_speed = defer;
+    atomic<int64_t> next_id(opt.id);
+    atomic<int> rc(0);
+    range_writer writer(range_os, range_log, opt.id);
+    for (int i = 0; i < pool.size(); i++) {
+        pool.submit([&opt, count, func, &next_id, &rc, &writer]() {
+                search_ids(opt, count, func, next_id, rc, writer);
+            });
+    }
+    pool.wait();
+    opt.coverage = saved_coverage;
+    if (defer) {
+        opt.defer_speed = false;
+        os << fill_speed(held.str());
+        os.flush();
+    }
+    if (opt.verbose) {
+        time_t t = time(NULL);
+        log << "range search end at " << ctime(&t) << endl;
+    }
+    return rc;
+}
+
+namespace {
+    /**
+     * take ids one by one and search parameters of them.
+     */
+    void search_ids(const options& opt, int count, search_func func,
+                    atomic<int64_t>& next_id, atomic<int>& rc,
+                    range_writer& writer) {
+        for (;;) {
+            int64_t id = next_id++;
+            if (id > opt.last_id) {
+                break;
+            }
+            options id_opt = opt;
+            id_opt.id = id;
+            id_opt.last_id = -1;
+            id_opt.threads = 1;
+            ostringstream out;
+            ostringstream lg;
+            id_result result;
+            ostream& id_log = writer.combined() ? out : lg;
+            try {
+                result.rc = func(id_opt, out, id_log, count, false);
+            } catch (exception& e) {
+                id_log << "# search error: " << dec << id << ", "
+                       << e.what() << endl;
+                result.rc = -1;
+            }
+            if (result.rc != 0) {
+                rc = result.rc;
+            }
+            result.out = out.str();
+            result.log = lg.str();
+            writer.put(id, result);
+        }
+    }
+}
@@ -0,0 +1,477 @@
+/**
+ * @file stattest.cpp
+ *
+ * @brief statistical tests applied to found parameters.
+ *
+ * Three tests are applied to the output of mt64::generate() without
+ * writing the outputs to files:
+ * - linear complexity test of NIST SP800-22 on each of 64 output bits,
+ * - birthday spacings test on upper and lower 32 bits,
+ * - binary rank test of 64x64 matrices.
+ *
+ * Tests of a parameter run concurrently, each on its own generator.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include "mt64Search.hpp"
+#include "stattest.h"
+
+using namespace std;
+using namespace MTToolBox;
+
+namespace {
+    enum {
+        buffer_size = 4096,
+        lc_block = 500,         // block length M of linear complexity
+        lc_blocks = 200,        // number of blocks N of each bit
+        bs_birthdays = 4096,    // birthdays in a year
+        bs_days_bits = 32,      // 2^32 days in a year
+        bs_years = 100,         // number of repetition
+        rank_matrices = 10000   // number of 64x64 matrices
+    };
+
+    /**
+     * @class output_buffer
+     * @brief outputs of mt64 generated buffer_size at once.
+     */
+    class output_buffer {
+    public:
+        output_buffer(const mt64_param& param, uint64_t seed) : g(param) {
+            g.seed(seed);
+            idx = buffer_size;
+        }
+
+        uint64_t next() {
+            if (idx >= buffer_size) {
+                for (int i = 0; i < buffer_size; i++) {
+                    buf[i] = g.generate();
+                }
+                idx = 0;
+            }
+            return buf[idx++];
+        }
+    private:
+        mt64 g;
+        uint64_t buf[buffer_size];
+        int idx;
+    };
+
+    double igamc(double a, double x);
+    double poisson_p_value(double lambda, long y);
+    int parity(uint64_t x);
+    int linear_complexity(const uint64_t seq[], int len);
+    int rank64(uint64_t mat[64]);
+    void linear_complexity_test(stat_result& result,
+                                const mt64_param& param, uint64_t seed);
+    void birthday_spacings_test(stat_result& hi, stat_result& lo,
+                                const mt64_param& param, uint64_t seed);
+    void matrix_rank_test(stat_result& result,
+                          const mt64_param& param, uint64_t seed);
+}
+
+/**
+ * parse comma separated names of tests.
+ * @param str names of tests, NULL means all tests
+ * @param tests bit mask of stat_test_kind
+ * @return false if unknown name is included
+ */
+bool parse_stat_tests(const char * str, int& tests) {
+    tests = 0;
+    if (str == NULL) {
+        tests = STAT_ALL;
+        return true;
+    }
+    string s = str;
+    size_t start = 0;
+    for (;;) {
+        size_t end = s.find(',', start);
+        string name = s.substr(start, end - start);
+        if (name == "lincomp") {
+            tests |= STAT_LINEAR_COMPLEXITY;
+        } else if (name == "bspace") {
+            tests |= STAT_BIRTHDAY_SPACINGS;
+        } else if (name == "rank") {
+            tests |= STAT_MATRIX_RANK;
+        } else if (name == "all") {
+            tests |= STAT_ALL;
+        } else {
+            return false;
+        }
+        if (end == string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+/**
+ * apply tests to the generator of the parameter.
+ * @param results p-values of tests
+ * @param param parameter of mt64
+ * @param seed seed of generator
+ * @param tests bit mask of stat_test_kind
+ */
+void stat_test(vector<stat_result>& results, const mt64_param& param,
+               uint64_t seed, int tests) {
+    stat_result lc;
+    stat_result bs_hi;
+    stat_result bs_lo;
+    stat_result rank;
+    vector<thread> workers;
+    if (tests & STAT_LINEAR_COMPLEXITY) {
+        workers.push_back(thread(linear_complexity_test,
+                                 ref(lc), cref(param), seed));
+    }
+    if (tests & STAT_BIRTHDAY_SPACINGS) {
+        workers.push_back(thread(birthday_spacings_test,
+                                 ref(bs_hi), ref(bs_lo), cref(param), seed));
+    }
+    if (tests & STAT_MATRIX_RANK) {
+        workers.push_back(thread(matrix_rank_test,
+                                 ref(rank), cref(param), seed));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    results.clear();
+    if (tests & STAT_LINEAR_COMPLEXITY) {
+        results.push_back(lc);
+    }
+    if (tests & STAT_BIRTHDAY_SPACINGS) {
+        results.push_back(bs_hi);
+        results.push_back(bs_lo);
+    }
+    if (tests & STAT_MATRIX_RANK) {
+        results.push_back(rank);
+    }
+}
+
+/**
+ * output p-values in the form name=p,name=p,... p-values are outputted
+ * by 4 significant digits, so small p-values are outputted like
+ * 1.234e-07 even if the stream is fixed, which would output 0.0000.
+ * The format of the stream is restored.
+ * @param os output stream
+ * @param results p-values of tests
+ */
+void output_stat_test(ostream& os, const vector<stat_result>& results) {
+    ios::fmtflags flags = os.flags();
+    streamsize precision = os.precision();
+    os.unsetf(ios::floatfield);
+    for (size_t i = 0; i < results.size(); i++) {
+        if (i != 0) {
+            os << ",";
+        }
+        os << results[i].name << "="
+           << setprecision(4) << results[i].p_value;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+namespace {
+    /**
+     * complemented incomplete gamma function Q(a, x)
+     */
+    double igamc(double a, double x) {
+        const double eps = 1.0e-15;
+        if (x <= 0) {
+            return 1.0;
+        }
+        double lg = a * log(x) - x - lgamma(a);
+        if (x < a + 1) {
+            double ap = a;
+            double del = 1.0 / a;
+            double sum = del;
+            for (int i = 0; i < 1000; i++) {
+                ap += 1;
+                del *= x / ap;
+                sum += del;
+                if (fabs(del) < fabs(sum) * eps) {
+                    break;
+                }
+            }
+            return 1.0 - sum * exp(lg);
+        }
+        // continued fraction by modified Lentz's method
+        const double tiny = 1.0e-300;
+        double b = x + 1 - a;
+        double c = 1 / tiny;
+        double d = 1 / b;
+        double h = d;
+        for (int i = 1; i < 1000; i++) {
+            double an = -i * (i - a);
+            b += 2;
+            d = an * d + b;
+            if (fabs(d) < tiny) {
+                d = tiny;
+            }
+            c = b + an / c;
+            if (fabs(c) < tiny) {
+                c = tiny;
+            }
+            d = 1 / d;
+            double del = d * c;
+            h *= del;
+            if (fabs(del - 1) < eps) {
+                break;
+            }
+        }
+        return exp(lg) * h;
+    }
+
+    /**
+     * two sided p-value of y for Poisson distribution
+     */
+    double poisson_p_value(double lambda, long y) {
+        double lower = 0;
+        for (long k = 0; k <= y; k++) {
+            lower += exp(k * log(lambda) - lambda - lgamma(k + 1.0));
+        }
+        double upper = 0;
+        for (long k = y; ; k++) {
+            double t = exp(k * log(lambda) - lambda - lgamma(k + 1.0));
+            upper += t;
+            if (k > lambda && t <= upper * 1.0e-17) {
+                break;
+            }
+        }
+        double p = 2 * min(lower, upper);
+        return min(p, 1.0);
+    }
+
+    int parity(uint64_t x) {
+        x ^= x >> 32;
+        x ^= x >> 16;
+        x ^= x >> 8;
+        x ^= x >> 4;
+        x ^= x >> 2;
+        x ^= x >> 1;
+        return static_cast<int>(x & 1);
+    }
+
+    /**
+     * Berlekamp-Massey algorithm on bit packed sequence.
+     * @param seq sequence, i-th bit is (seq[i / 64] >> (i % 64)) & 1
+     * @param len length of sequence
+     * @return linear complexity of the sequence
+     */
+    int linear_complexity(const uint64_t seq[], int len) {
+        const int nw = len / 64 + 2;
+        vector<uint64_t> c(nw, 0);
+        vector<uint64_t> b(nw, 0);
+        vector<uint64_t> t(nw);
+        // hist has s_n at bit 0, s_{n-1} at bit 1, ...
+        vector<uint64_t> hist(nw, 0);
+        c[0] = 1;
+        b[0] = 1;
+        int el = 0;
+        int m = 1;
+        for (int n = 0; n < len; n++) {
+            for (int i = nw - 1; i > 0; i--) {
+                hist[i] = (hist[i] << 1) | (hist[i - 1] >> 63);
+            }
+            hist[0] = (hist[0] << 1) | ((seq[n / 64] >> (n % 64)) & 1);
+            uint64_t d = 0;
+            for (int i = 0; i <= el / 64; i++) {
+                d ^= c[i] & hist[i];
+            }
+            if (!parity(d)) {
+                m++;
+                continue;
+            }
+            t = c;
+            // c ^= b * x^m
+            int ws = m / 64;
+            int bs = m % 64;
+            for (int i = nw - 1; i >= ws; i--) {
+                uint64_t w = b[i - ws] << bs;
+                if (bs != 0 && i - ws - 1 >= 0) {
+                    w |= b[i - ws - 1] >> (64 - bs);
+                }
+                c[i] ^= w;
+            }
+            if (2 * el <= n) {
+                el = n + 1 - el;
+                b = t;
+                m = 1;
+            } else {
+                m++;
+            }
+        }
+        return el;
+    }
+
+    /**
+     * rank of 64x64 matrix over GF(2)
+     */
+    int rank64(uint64_t mat[64]) {
+        int r = 0;
+        for (int bit = 63; bit >= 0 && r < 64; bit--) {
+            uint64_t mask = UINT64_C(1) << bit;
+            int p = r;
+            while (p < 64 && (mat[p] & mask) == 0) {
+                p++;
+            }
+            if (p == 64) {
+                continue;
+            }
+            swap(mat[r], mat[p]);
+            for (int i = r + 1; i < 64; i++) {
+                if (mat[i] & mask) {
+                    mat[i] ^= mat[r];
+                }
+            }
+            r++;
+        }
+        return r;
+    }
+
+    /**
+     * linear complexity test of NIST SP800-22 applied to each bit of
+     * outputs. p-values of 64 bits are combined by Sidak correction
+     * of the minimum.
+     */
+    void linear_complexity_test(stat_result& result,
+                                const mt64_param& param, uint64_t seed) {
+        static const double pi[7] = {0.010417, 0.03125, 0.125, 0.5,
+                                     0.25, 0.0625, 0.020833};
+        const int nw = (lc_block + 63) / 64;
+        const double sign = (lc_block % 2 == 0) ? 1.0 : -1.0;
+        const double mu = lc_block / 2.0 + (9.0 - sign) / 36.0
+            - (lc_block / 3.0 + 2.0 / 9.0) / pow(2.0, lc_block);
+        output_buffer buf(param, seed);
+        long v[64][7];
+        memset(v, 0, sizeof(v));
+        vector<uint64_t> bits(64 * nw);
+        for (int j = 0; j < lc_blocks; j++) {
+            fill(bits.begin(), bits.end(), 0);
+            for (int n = 0; n < lc_block; n++) {
+                uint64_t x = buf.next();
+                for (int b = 0; b < 64; b++) {
+                    bits[b * nw + n / 64] |= ((x >> b) & 1) << (n % 64);
+                }
+            }
+            for (int b = 0; b < 64; b++) {
+                int el = linear_complexity(&bits[b * nw], lc_block);
+                double t = sign * (el - mu) + 2.0 / 9.0;
+                int k;
+                if (t <= -2.5) {
+                    k = 0;
+                } else if (t > 2.5) {
+                    k = 6;
+                } else {
+                    k = static_cast<int>(ceil(t - 0.5)) + 3;
+                }
+                v[b][k]++;
+            }
+        }
+        double pmin = 1.0;
+        for (int b = 0; b < 64; b++) {
+            double chi = 0;
+            for (int k = 0; k < 7; k++) {
+                double e = lc_blocks * pi[k];
+                chi += (v[b][k] - e) * (v[b][k] - e) / e;
+            }
+            pmin = min(pmin, igamc(3.0, chi / 2));
+        }
+        result.name = "lincomp";
+        result.p_value = -expm1(64 * log1p(-pmin));
+    }
+
+    /**
+     * birthday spacings test. 4096 birthdays in 2^32 days, expected
+     * number of collisions of spacings is 4 for each year.
+     */
+    void birthday_spacings_test(stat_result& hi, stat_result& lo,
+                                const mt64_param& param, uint64_t seed) {
+        const double lambda = pow(2.0, 3 * 12 - 2 - bs_days_bits)
+            * bs_years;
+        output_buffer buf(param, seed);
+        vector<uint64_t> days[2];
+        days[0].resize(bs_birthdays);
+        days[1].resize(bs_birthdays);
+        long collisions[2] = {0, 0};
+        for (int y = 0; y < bs_years; y++) {
+            for (int i = 0; i < bs_birthdays; i++) {
+                uint64_t x = buf.next();
+                days[0][i] = x >> (64 - bs_days_bits);
+                days[1][i] = x & ((UINT64_C(1) << bs_days_bits) - 1);
+            }
+            for (int w = 0; w < 2; w++) {
+                vector<uint64_t>& d = days[w];
+                sort(d.begin(), d.end());
+                for (int i = bs_birthdays - 1; i > 0; i--) {
+                    d[i] -= d[i - 1];
+                }
+                sort(d.begin(), d.end());
+                for (int i = 1; i < bs_birthdays; i++) {
+                    if (d[i] == d[i - 1]) {
+                        collisions[w]++;
+                    }
+                }
+            }
+        }
+        hi.name = "bspace-hi";
+        hi.p_value = poisson_p_value(lambda, collisions[0]);
+        lo.name = "bspace-lo";
+        lo.p_value = poisson_p_value(lambda, collisions[1]);
+    }
+
+    /**
+     * binary rank test of 64x64 matrices whose rows are outputs.
+     * ranks are classified into 64, 63 and less than 63.
+     */
+    void matrix_rank_test(stat_result& result,
+                          const mt64_param& param, uint64_t seed) {
+        double prob[3];
+        prob[0] = 0;
+        prob[1] = 0;
+        for (int r = 63; r <= 64; r++) {
+            double p = pow(2.0, r * (128.0 - r) - 64.0 * 64.0);
+            for (int i = 0; i < r; i++) {
+                double a = 1 - pow(2.0, i - 64.0);
+                p *= a * a / (1 - pow(2.0, static_cast<double>(i - r)));
+            }
+            prob[64 - r] = p;
+        }
+        prob[2] = 1 - prob[0] - prob[1];
+        output_buffer buf(param, seed);
+        long count[3] = {0, 0, 0};
+        uint64_t mat[64];
+        for (int j = 0; j < rank_matrices; j++) {
+            for (int i = 0; i < 64; i++) {
+                mat[i] = buf.next();
+            }
+            int r = rank64(mat);
+            count[min(64 - r, 2)]++;
+        }
+        double chi = 0;
+        for (int k = 0; k < 3; k++) {
+            double e = rank_matrices * prob[k];
+            chi += (count[k] - e) * (count[k] - e) / e;
+        }
+        result.name = "rank";
+        result.p_value = igamc(1.0, chi / 2);
+    }
+}
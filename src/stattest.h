@@ -0,0 +1,48 @@
+#pragma once
+#ifndef STATTEST_H
+#define STATTEST_H
+/**
+ * @file stattest.h
+ *
+ * @brief statistical tests applied to found parameters.
+ *
+ * @author Mutsuo Saito
+ * @author Makoto Matsumoto (Hiroshima University)
+ * @author Takuji Nishimura (Yamagata University)
+ *
+ * Copyright (C) 2019 Mutsuo Saito, Makoto Matsumoto,
+ * Takuji Nishimura and Hiroshima University.
+ * All rights reserved.
+ *
+ * The MIT License is applied to this software, see
+ * LICENSE
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace MTToolBox {
+    class mt64_param;
+}
+
+enum stat_test_kind {
+    STAT_LINEAR_COMPLEXITY = 1,
+    STAT_BIRTHDAY_SPACINGS = 2,
+    STAT_MATRIX_RANK = 4,
+    STAT_ALL = 7
+};
+
+struct stat_result {
+    std::string name;
+    double p_value;
+};
+
+bool parse_stat_tests(const char * str, int& tests);
+void stat_test(std::vector<stat_result>& results,
+               const MTToolBox::mt64_param& param, uint64_t seed, int tests);
+void output_stat_test(std::ostream& os,
+                      const std::vector<stat_result>& results);
+
+#endif // STATTEST_H